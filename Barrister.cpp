@@ -4,6 +4,17 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <deque>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <chrono>
+#include <sys/resource.h>
 
 #include "toml/toml.hpp"
 
@@ -14,6 +25,10 @@
 #include "RotorDescription.hpp"
 #include "Params.hpp"
 #include "Parsing.hpp"
+#include "TranspositionTable.hpp"
+#include "Nogoods.hpp"
+#include "ProbeCache.hpp"
+#include "ProbePool.hpp"
 
 // Idea:
 //
@@ -51,12 +66,14 @@
 // then the current cell is likely to be swamped in the next
 // generation or two
 
-const unsigned maxFrontierGens = 6;
-const unsigned maxBranchFastCount = 1;
-const unsigned maxCalculateRounds = 1;
+// With `adaptive-lookahead`, the lookahead is shortened after this
+// many frontier calculations where its last two generations forced
+// nothing
+const unsigned lookaheadPatience = 16;
 
-const unsigned maxCellActiveWindowGens = 0;
-const unsigned maxCellActiveStreakGens = 0;
+// RefineFrontier redoes the whole frontier rather than just its stale
+// columns once there are more than this many
+const unsigned refineMaxStaleColumns = 16;
 
 struct Solution {
   LifeState state;
@@ -70,6 +87,15 @@ struct Solution {
 
   CompletionResult completionResult;
 
+  // The branch choices leading to the node that found this solution,
+  // so that solutions from separate shards can be put back into search
+  // order
+  std::vector<uint8_t> branchPath;
+
+  // With `report-oscillators`, the new rotor this solution was recorded
+  // for, so that rotors found by several shards are only kept once
+  std::string rotor;
+
   bool operator==(const Solution&) const = default; // I don't really know why I need to say this
 
   // Doesn't have to be fast
@@ -79,8 +105,82 @@ struct Solution {
     if (auto c = recoveryGen <=> other.recoveryGen; c != 0) return c;
     return stable.state.GetHash() <=> other.stable.state.GetHash();
   }
+
+  void Write(std::ostream &out) const;
+  static std::optional<Solution> Read(std::istream &in);
 };
 
+void WriteState(std::ostream &out, const LifeState &state) {
+  for (unsigned i = 0; i < N; i++)
+    out << ' ' << state[i];
+  out << std::endl;
+}
+
+void ReadState(std::istream &in, LifeState &state) {
+  for (unsigned i = 0; i < N; i++)
+    in >> state[i];
+}
+
+void WriteState(std::ostream &out, const LifeStableState &stable) {
+  for (auto *plane : {&stable.state, &stable.unknown, &stable.live2, &stable.live3,
+                      &stable.dead0, &stable.dead1, &stable.dead2,
+                      &stable.dead4, &stable.dead5, &stable.dead6})
+    WriteState(out, *plane);
+}
+
+void ReadState(std::istream &in, LifeStableState &stable) {
+  for (auto *plane : {&stable.state, &stable.unknown, &stable.live2, &stable.live3,
+                      &stable.dead0, &stable.dead1, &stable.dead2,
+                      &stable.dead4, &stable.dead5, &stable.dead6})
+    ReadState(in, *plane);
+}
+
+void Solution::Write(std::ostream &out) const {
+  out << std::hex;
+  out << "solution " << interactionGen << " " << recoveryGen << " "
+      << static_cast<unsigned>(completionResult) << " " << branchPath.size();
+  for (auto b : branchPath)
+    out << " " << static_cast<unsigned>(b);
+  if (!rotor.empty())
+    out << " " << rotor;
+  out << std::endl;
+  WriteState(out, state);
+  WriteState(out, completed);
+  WriteState(out, stable);
+  WriteState(out, interactionStable);
+  WriteState(out, stator);
+  out << std::dec;
+}
+
+std::optional<Solution> Solution::Read(std::istream &in) {
+  std::string header;
+  if (!(in >> header) || header != "solution")
+    return std::nullopt;
+
+  Solution result;
+  unsigned completion, pathLength;
+  in >> std::hex >> result.interactionGen >> result.recoveryGen >> completion >> pathLength;
+  result.completionResult = static_cast<CompletionResult>(completion);
+  for (unsigned i = 0; i < pathLength; i++) {
+    unsigned b;
+    in >> b;
+    result.branchPath.push_back(b);
+  }
+  std::getline(in, result.rotor); // The rest of the line
+  if (!result.rotor.empty() && result.rotor[0] == ' ')
+    result.rotor.erase(0, 1);
+  ReadState(in, result.state);
+  ReadState(in, result.completed);
+  ReadState(in, result.stable);
+  ReadState(in, result.interactionStable);
+  ReadState(in, result.stator);
+  in >> std::dec;
+
+  if (!in)
+    return std::nullopt;
+  return result;
+}
+
 Transition AllowedTransitions(bool state, bool unknownstable, bool stablestate,
                               bool forcedInactive, bool forcedUnchanging, bool inzoi, Transition unperturbed) {
   auto result = Transition::ANY & ~Transition::STABLE_TO_STABLE;
@@ -110,10 +210,19 @@ Transition AllowedTransitions(bool state, bool unknownstable, bool stablestate,
   return result;
 }
 
+// The cells for which each transition is allowed
+struct TransitionPlanes {
+  LifeState offToOff;
+  LifeState offToOn;
+  LifeState onToOff;
+  LifeState onToOn;
+};
+
 struct FrontierGeneration {
   LifeUnknownState state;
   LifeUnknownState next;
   LifeState frontierCells;
+  LifeState semiFrontier; // Frontier cells of the later lookahead generations
   LifeState active;
   LifeState changes;
   LifeState forcedInactive;
@@ -140,83 +249,307 @@ struct FrontierGeneration {
 
     return allowedTransitions;
   }
+
+  // AllowedTransitions for every cell at once
+  TransitionPlanes AllowedTransitionPlanes(const LifeStableState &stable) const {
+    const LifeState &current = state.state;
+    LifeState unperturbedNext = current;
+    unperturbedNext.Step();
+
+    LifeState knownOn = ~stable.unknown & current;
+    LifeState knownOff = ~stable.unknown & ~current;
+    LifeState inactiveZOI = forcedInactive & stable.dead0;
+    LifeState inactiveOutside = forcedInactive & ~stable.dead0;
+    LifeState unchangingZOI = forcedUnchanging & stable.dead0;
+
+    TransitionPlanes result;
+    result.offToOff = ~knownOn & ~(inactiveZOI & ~stable.unknown & stable.state);
+    result.offToOn = ~knownOn & ~(inactiveZOI & stable.unknown) &
+                     ~(inactiveZOI & ~stable.unknown & ~stable.state) &
+                     ~(inactiveOutside & ~(~current & unperturbedNext)) &
+                     ~unchangingZOI;
+    result.onToOff = ~knownOff & ~(inactiveZOI & stable.unknown) &
+                     ~(inactiveZOI & ~stable.unknown & stable.state) &
+                     ~(inactiveOutside & ~(current & ~unperturbedNext)) &
+                     ~unchangingZOI;
+    result.onToOn = ~knownOff & ~(inactiveZOI & ~stable.unknown & ~stable.state);
+    return result;
+  }
+};
+
+template <typename State> class SearchWorker;
+class SearchCheckpoint;
+
+struct SearchStats {
+  std::atomic<uint64_t> nodes;
+  std::atomic<uint64_t> nogoodsLearned;
+  std::atomic<uint64_t> nogoodRefutations;
+  std::atomic<uint64_t> regionSplits;
+  std::atomic<uint64_t> lookaheads;
+  std::atomic<uint64_t> lookaheadGenerations;
+};
+
+// The cell chosen at a node, and the transitions still to be tried
+struct BranchPoint {
+  std::pair<int, int> cell;
+  Transition remaining;
+  unsigned index;
 };
 
+// The countdown widths are template parameters so that each search
+// only carries the counters its parameters need, see countdownBuckets
+template <uint32_t windowMax, uint32_t streakMax>
 class SearchState {
 public:
+  using WindowCountdown = LifeCountdown<windowMax>;
+  using StreakCountdown = LifeCountdown<streakMax>;
+
   LifeStableState stable;
   FrontierGeneration frontier;
 
   LifeState everActive;
 
-  LifeCountdown<maxCellActiveWindowGens> activeTimer;
-  LifeCountdown<maxCellActiveStreakGens> streakTimer;
+  WindowCountdown activeTimer;
+  StreakCountdown streakTimer;
 
-  LifeStableState lastTest;
+  // Where `stable` stood when unknowns were last tested, if they have
+  // been, see StableRefinement
+  bool hasTested;
+  StableRefinement lastTest;
+#ifdef DEBUG
+  LifeStableState lastTestStable;
+#endif
 
   unsigned timeSincePropagate;
 
+  // Columns where `stable` may have changed since the active and
+  // changed cells of `frontier` were last worked out
+  uint64_t staleColumns;
+
+  // Generations PopulateFrontier looks ahead, inherited by the subtree
+  // and adjusted along it with `adaptive-lookahead`
+  unsigned lookaheadGens;
+  unsigned idleLookaheads;
+
   unsigned currentGen;
 
   bool hasInteracted;
   unsigned interactionStart;
   unsigned recoveredTime;
 
+  // The branch choices taken to reach this node. Only kept when
+  // sharding or checkpointing, as it is copied along with the state
+  unsigned depth;
+  bool tracksPath;
+  std::vector<uint8_t> branchPath;
+
+  // The cell branched on to reach this node, or (-1, -1)
+  std::pair<int, int> lastBranchCell;
+
+  // Whether this node lies strictly above the checkpoint being resumed
+  // from, in which case its solutions have already been recorded
+  bool replaying;
+
   SearchParams *params;
   std::vector<Solution> *allSolutions;
   std::set<std::string> *seenRotors;
   LifeStableState *stableAtInteraction;
-
+  SearchWorker<SearchState> *worker;
+  SearchCheckpoint *checkpoint;
+  SearchStats *stats;
+  TranspositionTable *transpositions;
+  NogoodStore *nogoods;
+  ProbePool *probePool;
+  ProbeCache *probeCache;
+
+  SearchState() = default;
   SearchState(SearchParams &inparams, std::vector<Solution> &outsolutions, std::set<std::string> &outrotors, LifeStableState &stableAtInteraction);
   SearchState(const SearchState &) = default;
   SearchState &operator=(const SearchState &) = default;
 
   LifeState ForcedInactiveCells(
       const FrontierGeneration &gen, const LifeState &everActive,
-      const LifeCountdown<maxCellActiveWindowGens> &activeTimer,
-      const LifeCountdown<maxCellActiveStreakGens> &streakTimer) const;
+      const WindowCountdown &activeTimer,
+      const StreakCountdown &streakTimer) const;
 
 
   LifeState ForcedUnchangingCells(
       const FrontierGeneration &gen, const LifeState &everActive,
-      const LifeCountdown<maxCellActiveWindowGens> &activeTimer,
-      const LifeCountdown<maxCellActiveStreakGens> &streakTimer) const;
+      const WindowCountdown &activeTimer,
+      const StreakCountdown &streakTimer) const;
 
 
   bool UpdateActive(FrontierGeneration &generation,
-                    LifeCountdown<maxCellActiveWindowGens> &activeTimer,
-                    LifeCountdown<maxCellActiveStreakGens> &streakTimer);
+                    WindowCountdown &activeTimer,
+                    StreakCountdown &streakTimer);
+  // Only recomputing the active and changed cells in `columns`
+  bool UpdateActive(FrontierGeneration &generation, uint64_t columns,
+                    WindowCountdown &activeTimer,
+                    StreakCountdown &streakTimer);
+  bool UpdateForced(FrontierGeneration &generation,
+                    WindowCountdown &activeTimer,
+                    StreakCountdown &streakTimer);
   std::pair<bool, bool> SetForced(FrontierGeneration &generation);
 
   std::pair<bool, bool> TestActive(FrontierGeneration &generation);
 
-  std::tuple<bool, bool> PopulateFrontier();
-  bool UpdateFrontierStrip(unsigned column);
+  std::tuple<bool, bool> PopulateFrontier(StableRefinement &atFrontier);
+  void AdaptLookahead(int deepestForced);
   bool CalculateFrontier();
   bool RefineFrontier();
+  bool RefineFrontierBoard();
   std::pair<bool, bool> TryAdvance();
 
   StableOptions OptionsFor(const LifeUnknownState &state,
                            std::pair<int, int> cell,
                            Transition transition) const;
 
+  LifeState FocusedRegion() const;
   std::pair<unsigned, std::pair<int, int>> ChooseBranchCell() const;
-
+  uint64_t Hash() const;
+  bool BranchInShard(unsigned branchIndex) const;
+  bool BranchFinished(unsigned branchIndex) const;
+  bool BranchReplaying(unsigned branchIndex) const;
+  const std::vector<uint8_t> &Position() const;
+  void SaveCheckpoint();
+
+  bool PrepareBranch(BranchPoint &branch);
+  bool BranchRefuted(std::pair<int, int> branchCell, Transition transition) const;
+  std::pair<bool, unsigned> ProbeTransition(std::pair<int, int> cell, Transition transition);
+  bool ProbeBranchCells(std::pair<int, int> preferred, BranchPoint &branch);
+  bool ApplyBranch(std::pair<int, int> branchCell, Transition transition, unsigned branchIndex);
   void SearchStep();
 
   void RecordOscillator();
 
-  void RecordSolution();
+  void RecordSolution(const std::string &rotor = "");
   void PrintSolution(const Solution &solution);
+  std::unique_lock<std::mutex> LockResults() const;
 
   void SanityCheck();
 };
 
-LifeState SearchState::ForcedInactiveCells(
+// Alternative to the recursion in SearchStep, which keeps one frame per
+// depth in an arena that is reused on backtrack
+template <typename State>
+struct SearchFrame {
+  State search;
+  BranchPoint branch;
+};
+
+template <typename State>
+class SearchStack {
+public:
+  std::vector<SearchFrame<State>> frames;
+
+  SearchStack() : frames(64) {}
+  void Run(const State &root);
+};
+
+template <typename State>
+void RunSearch(State &search, SearchStack<State> &stack) {
+  switch (search.params->engine) {
+  case SearchEngine::RECURSIVE:
+    search.SearchStep();
+    break;
+  case SearchEngine::ITERATIVE:
+    stack.Run(search);
+    break;
+  }
+}
+
+// With `threads` > 1 the sibling subtrees of SearchStep are handed out
+// through per-thread deques. A worker only pushes a spare branch onto
+// its own deque while some other worker is idle, pops from the back of
+// its own deque, and steals from the front of the others when it runs
+// dry.
+template <typename State>
+struct SearchTask {
+  State search;
+  LifeStableState stableAtInteraction;
+};
+
+template <typename State> class SearchPool;
+
+template <typename State>
+class SearchWorker {
+public:
+  SearchPool<State> *pool;
+  std::mutex mutex;
+  std::deque<SearchTask<State>> tasks;
+  std::atomic<unsigned> queued;
+
+  // Each worker owns the interaction snapshot for the subtree it is
+  // currently searching
+  LifeStableState stableAtInteraction;
+  NogoodStore nogoods;
+  std::optional<ProbePool> probePool;
+
+  // Where this worker is in the tree, only kept up to date when
+  // checkpointing
+  bool busy;
+  std::vector<uint8_t> position;
+  void SetPosition(const std::vector<uint8_t> &newPosition);
+
+  SearchStack<State> stack;
+
+  bool ShouldSpawn() const;
+  void Push(const State &search);
+  std::optional<SearchTask<State>> Pop();
+  std::optional<SearchTask<State>> Steal();
+  void Run(SearchTask<State> &task);
+  void Loop();
+};
+
+template <typename State>
+class SearchPool {
+public:
+  std::vector<SearchWorker<State>> workers;
+  std::atomic<unsigned> pending; // Tasks queued or running
+  std::atomic<unsigned> idle;
+  std::mutex resultsMutex;
+
+  // Idle workers sleep here until a task is queued or the search ends
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+
+  SearchPool(unsigned threads);
+  void Run(const State &root);
+  std::vector<uint8_t> Watermark();
+  void Wake(bool all);
+  void WaitForWork();
+};
+
+// Every `checkpoint-interval` seconds the search saves a branch path W
+// such that every node before W in search order has been fully
+// explored, together with the solutions found so far before W.
+// Resuming replays the search down to W, skipping the finished
+// siblings along the way. The rotors seen before W are those of the
+// saved solutions, as only a new rotor records a solution.
+class SearchCheckpoint {
+public:
+  std::string filename;
+  std::chrono::steady_clock::duration interval;
+  std::atomic<std::chrono::steady_clock::rep> nextSave;
+
+  SearchCheckpoint(const std::string &filename, unsigned intervalSecs);
+
+  bool Due();
+  void Save(const std::vector<uint8_t> &watermark,
+            const std::vector<Solution> &solutions) const;
+  void Remove() const;
+  static bool Load(const std::string &filename,
+                   std::vector<uint8_t> &watermark,
+                   std::vector<Solution> &solutions,
+                   std::set<std::string> &rotors);
+};
+
+template <uint32_t windowMax, uint32_t streakMax>
+LifeState SearchState<windowMax, streakMax>::ForcedInactiveCells(
     const FrontierGeneration &gen,
     const LifeState &everActive,
-    const LifeCountdown<maxCellActiveWindowGens> &activeTimer,
-    const LifeCountdown<maxCellActiveStreakGens> &streakTimer) const {
+    const WindowCountdown &activeTimer,
+    const StreakCountdown &streakTimer) const {
   if (gen.gen < params->minFirstActiveGen) {
     return ~LifeState();
   }
@@ -295,11 +628,12 @@ LifeState SearchState::ForcedInactiveCells(
   return result;
 }
 
-LifeState SearchState::ForcedUnchangingCells(
+template <uint32_t windowMax, uint32_t streakMax>
+LifeState SearchState<windowMax, streakMax>::ForcedUnchangingCells(
     const FrontierGeneration &gen,
     const LifeState &everActive,
-    const LifeCountdown<maxCellActiveWindowGens> &activeTimer,
-    const LifeCountdown<maxCellActiveStreakGens> &streakTimer)
+    const WindowCountdown &activeTimer,
+    const StreakCountdown &streakTimer)
     const {
   LifeState result;
   if (params->maxChanges != -1) {
@@ -370,9 +704,10 @@ StableOptions OptionsFor(bool currentstate, bool nextstate, unsigned currenton,
   return result;
 }
 
-StableOptions SearchState::OptionsFor(const LifeUnknownState &state,
-                                      std::pair<int, int> cell,
-                                      Transition transition) const {
+template <uint32_t windowMax, uint32_t streakMax>
+StableOptions SearchState<windowMax, streakMax>::OptionsFor(const LifeUnknownState &state,
+                                                            std::pair<int, int> cell,
+                                                            Transition transition) const {
   unsigned currenton = state.state.CountNeighbours(cell);
   unsigned unknown = state.unknown.CountNeighbours(cell);
   unsigned stableon = stable.state.CountNeighbours(cell);
@@ -410,12 +745,41 @@ StableOptions SearchState::OptionsFor(const LifeUnknownState &state,
   return options;
 }
 
-bool SearchState::UpdateActive(FrontierGeneration &generation,
-                               LifeCountdown<maxCellActiveWindowGens> &activeTimer,
-                               LifeCountdown<maxCellActiveStreakGens> &streakTimer) {
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::UpdateActive(FrontierGeneration &generation,
+                                                     WindowCountdown &activeTimer,
+                                                     StreakCountdown &streakTimer) {
   generation.active = generation.next.ActiveComparedTo(stable) & stable.dead0 & ~params->exempt;
   generation.changes = generation.next.ChangesComparedTo(generation.state) & stable.dead0 & ~params->exempt;
 
+  return UpdateForced(generation, activeTimer, streakTimer);
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::UpdateActive(FrontierGeneration &generation,
+                                                     uint64_t columns,
+                                                     WindowCountdown &activeTimer,
+                                                     StreakCountdown &streakTimer) {
+  const LifeUnknownState &state = generation.state;
+  const LifeUnknownState &next = generation.next;
+  for (uint64_t remaining = columns; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    uint64_t relevant = stable.dead0[i] & ~params->exempt[i];
+    generation.active[i] = ~next.unknown[i] & ~stable.unknown[i] &
+                           (stable.state[i] ^ next.state[i]) & relevant;
+    generation.changes[i] = (next.state[i] ^ state.state[i]) &
+                            ~next.unknown[i] & ~state.unknown[i] & relevant;
+  }
+
+  return UpdateForced(generation, activeTimer, streakTimer);
+}
+
+// The constraints depend on counts and bounds over the whole board, so
+// these are always worked out in full
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::UpdateForced(FrontierGeneration &generation,
+                                                     WindowCountdown &activeTimer,
+                                                     StreakCountdown &streakTimer) {
   everActive |= generation.active;
 
   generation.forcedInactive =
@@ -435,7 +799,8 @@ bool SearchState::UpdateActive(FrontierGeneration &generation,
   return true;
 }
 
-std::pair<bool, bool> SearchState::SetForced(FrontierGeneration &generation) {
+template <uint32_t windowMax, uint32_t streakMax>
+std::pair<bool, bool> SearchState<windowMax, streakMax>::SetForced(FrontierGeneration &generation) {
   bool anyChanges = false;
   LifeState remainingCells = generation.frontierCells;
   for (auto cell = remainingCells.FirstOn(); cell != std::make_pair(-1, -1);
@@ -499,7 +864,8 @@ std::pair<bool, bool> SearchState::SetForced(FrontierGeneration &generation) {
   return {true, anyChanges};
 }
 
-std::tuple<bool, bool> SearchState::PopulateFrontier() {
+template <uint32_t windowMax, uint32_t streakMax>
+std::tuple<bool, bool> SearchState<windowMax, streakMax>::PopulateFrontier(StableRefinement &atFrontier) {
   bool anyChanges = false;
 
   frontier.state.TransferStable(stable);
@@ -510,13 +876,25 @@ std::tuple<bool, bool> SearchState::PopulateFrontier() {
   auto lookaheadActiveTimer = activeTimer;
   auto lookaheadStreakTimer = streakTimer;
 
-  for (unsigned i = 0; i < maxFrontierGens; i++) {
+  // Shared by the generations until SetForced changes the stable state
+  LifeState countedState = stable.state;
+  NeighbourCount stableCount(countedState);
+
+  int deepestForced = -1;
+  bool isInert = false;
+  unsigned i = 0;
+  for (; i < lookaheadGens; i++) {
     gen++;
 
+    if (stable.state != countedState) {
+      countedState = stable.state;
+      stableCount = NeighbourCount(countedState);
+    }
+
     FrontierGeneration generation;
 
     generation.state = lookahead;
-    generation.next = lookahead.StepMaintaining(stable);
+    generation.next = lookahead.StepMaintaining(stable, stableCount);
     generation.gen = gen;
 
     bool updateresult = UpdateActive(generation, lookaheadActiveTimer, lookaheadStreakTimer);
@@ -538,50 +916,67 @@ std::tuple<bool, bool> SearchState::PopulateFrontier() {
 
     generation.frontierCells = becomeUnknown & ~prevUnknownActive.ZOI();
 
-    if (i == 0)
+    if (i == 0) {
       frontier = generation;
+      atFrontier = stable.Refinement();
+    } else
+      frontier.semiFrontier |= generation.frontierCells;
 
     auto [result, someForced] = SetForced(generation);
     if (!result)
       return {false, false};
 
     anyChanges = anyChanges || someForced;
+    if (someForced)
+      deepestForced = i;
 
-    bool isInert = ((generation.state.state ^ generation.next.state) &
-                   ~generation.state.unknown & ~generation.next.unknown)
-                      .IsEmpty() ||
-                  (stable.dead0 & ~params->exempt & ~generation.next.unknown).IsEmpty();
+    isInert = ((generation.state.state ^ generation.next.state) &
+              ~generation.state.unknown & ~generation.next.unknown)
+                 .IsEmpty() ||
+             (stable.dead0 & ~params->exempt & ~generation.next.unknown).IsEmpty();
 
     if (isInert)
       break;
 
     lookahead = generation.next;
   }
-  return {true, anyChanges};
-}
-
-bool SearchState::UpdateFrontierStrip(unsigned column) {
-  stable.SynchroniseStateKnown();
-
-  frontier.state.TransferStable(stable);
 
-  auto stripState = frontier.state.state.GetStrip<4>(column);
-  auto stripUnknown = frontier.state.unknown.GetStrip<4>(column);
-  auto stripUnknownStable = frontier.state.unknownStable.GetStrip<4>(column);
+  if (stats != nullptr && params->adaptiveLookahead.first != -1) {
+    stats->lookaheads.fetch_add(1, std::memory_order_relaxed);
+    stats->lookaheadGenerations.fetch_add(std::min(i + 1, lookaheadGens), std::memory_order_relaxed);
+  }
 
-  std::tie(stripState, stripUnknown, stripUnknownStable) = frontier.state.StepMaintainingStrip(stable, column);
-  frontier.next.state.SetStrip<4>(column, stripState);
-  frontier.next.unknown.SetStrip<4>(column, stripUnknown);
-  frontier.next.unknownStable.SetStrip<4>(column, stripUnknownStable);
+  // An inert generation cuts the lookahead short whatever its length
+  if (params->adaptiveLookahead.first != -1 && !isInert)
+    AdaptLookahead(deepestForced);
 
-  bool updateresult = UpdateActive(frontier, activeTimer, streakTimer);
-  if (!updateresult)
-    return false;
+  return {true, anyChanges};
+}
 
-  return true;
+// Deepen the lookahead when its last generation forces cells, and
+// shorten it when the last two generations have stopped doing so
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchState<windowMax, streakMax>::AdaptLookahead(int deepestForced) {
+  unsigned minGens = params->adaptiveLookahead.first;
+  unsigned maxGens = params->adaptiveLookahead.second;
+
+  if (deepestForced + 1 == (int)lookaheadGens) {
+    idleLookaheads = 0;
+    if (lookaheadGens < maxGens)
+      lookaheadGens++;
+  } else if (deepestForced + 2 < (int)lookaheadGens) {
+    idleLookaheads++;
+    if (idleLookaheads >= lookaheadPatience && lookaheadGens > minGens) {
+      lookaheadGens--;
+      idleLookaheads = 0;
+    }
+  } else {
+    idleLookaheads = 0;
+  }
 }
 
-std::pair<bool, bool> SearchState::TryAdvance() {
+template <uint32_t windowMax, uint32_t streakMax>
+std::pair<bool, bool> SearchState<windowMax, streakMax>::TryAdvance() {
   bool didAdvance = false;
   bool done = false;
   while (!done) {
@@ -591,7 +986,11 @@ std::pair<bool, bool> SearchState::TryAdvance() {
     didAdvance = true;
 
     frontier.state = frontier.next;
-    frontier.next = frontier.next.StepMaintaining(stable);
+    // Before the first interaction the pattern is usually flying in
+    // from far away. Afterwards it is nearly always next to unknown
+    // cells, and checking for that costs more than it saves.
+    if (hasInteracted || !frontier.next.StepKnown(stable))
+      frontier.next = frontier.state.StepMaintaining(stable);
     currentGen += 1;
 
     LifeState active = frontier.state.ActiveComparedTo(stable) & stable.dead0 & ~params->exempt;
@@ -638,19 +1037,23 @@ std::pair<bool, bool> SearchState::TryAdvance() {
   return {true, didAdvance};
 }
 
-bool SearchState::CalculateFrontier() {
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::CalculateFrontier() {
 
   unsigned rounds = 0;
 
+  // Where `stable` stood when the frontier was taken
+  StableRefinement atFrontier;
+
   bool anyChanges = true;
   while (anyChanges) {
     anyChanges = false;
 
     rounds++;
-    if (rounds > maxCalculateRounds)
+    if (rounds > params->calculateRounds)
       break;
 
-    auto [consistent, someChanges] = PopulateFrontier();
+    auto [consistent, someChanges] = PopulateFrontier(atFrontier);
     if (!consistent) {
       return false;
     }
@@ -660,16 +1063,31 @@ bool SearchState::CalculateFrontier() {
     // spend a fair bit of time searching uncompletable parts of the
     // search space
 
-    LifeState toTest = stable.Vulnerable() & stable.Differences(lastTest).ZOI();
-    lastTest = stable;
-    auto propagateResult = stable.TestUnknowns(toTest);
+    if (params->testUnknowns) {
+      StableRefinement refinement = stable.Refinement();
+      LifeState changes = hasTested ? refinement.Differences(lastTest)
+                                    : stable.Differences(LifeStableState());
+      LifeState nearChanges = changes.ZOI();
+      LifeState toTest = stable.Vulnerable(nearChanges.PopulatedColumns()) & nearChanges;
+#ifdef DEBUG
+      if (hasTested)
+        assert(changes == stable.Differences(lastTestStable));
+      assert(toTest == (stable.Vulnerable() & nearChanges));
+      lastTestStable = stable;
+#endif
+      hasTested = true;
+      lastTest = refinement;
+      auto testResult = probePool != nullptr    ? probePool->TestUnknowns(stable, toTest)
+                        : probeCache != nullptr ? probeCache->TestUnknowns(stable, toTest)
+                                                : stable.TestUnknowns(toTest);
 
-    if (!propagateResult.consistent) {
-      return false;
+      if (!testResult.consistent) {
+        return false;
+      }
+      anyChanges = anyChanges || testResult.changed;
     }
-    anyChanges = anyChanges || propagateResult.changed;
 
-    propagateResult = stable.Propagate();
+    auto propagateResult = stable.Propagate();
     if (!propagateResult.consistent) {
       return false;
     }
@@ -702,10 +1120,65 @@ bool SearchState::CalculateFrontier() {
     return CalculateFrontier();
   }
 
+  staleColumns = stable.Refinement().Differences(atFrontier).PopulatedColumns();
+
   return true;
 }
 
-bool SearchState::RefineFrontier() {
+// Bring the frontier up to date with the branches taken since it was
+// calculated. Usually only a strip around each branch cell has changed,
+// so only those columns are redone.
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::RefineFrontier() {
+  if ((unsigned)std::popcount(staleColumns) > refineMaxStaleColumns)
+    return RefineFrontierBoard();
+
+#ifdef DEBUG
+  SearchState reference = *this;
+  bool referenceConsistent = reference.RefineFrontierBoard();
+#endif
+
+  for (uint64_t remaining = staleColumns; remaining != 0; remaining &= remaining - 1) {
+    auto [abort, changes] = stable.SynchroniseStateKnownColumn(std::countr_zero(remaining));
+    if (abort != 0)
+      return false;
+  }
+
+  frontier.state.TransferStableColumns(stable, staleColumns);
+  frontier.next.TransferStableColumns(stable, staleColumns);
+
+  bool updateresult = UpdateActive(frontier, staleColumns, activeTimer, streakTimer);
+  if (!updateresult) {
+#ifdef DEBUG
+    assert(!referenceConsistent);
+#endif
+    return false;
+  }
+
+  staleColumns = frontier.frontierCells.PopulatedColumns();
+
+  auto [consistent, changed] = SetForced(frontier);
+
+#ifdef DEBUG
+  assert(consistent == referenceConsistent);
+  if (consistent) {
+    assert(stable == reference.stable);
+    assert(frontier.state == reference.frontier.state);
+    assert(frontier.next == reference.frontier.next);
+    assert(frontier.frontierCells == reference.frontier.frontierCells);
+    assert(frontier.active == reference.frontier.active);
+    assert(frontier.changes == reference.frontier.changes);
+    assert(frontier.forcedInactive == reference.frontier.forcedInactive);
+    assert(frontier.forcedUnchanging == reference.frontier.forcedUnchanging);
+    assert(everActive == reference.everActive);
+  }
+#endif
+
+  return consistent;
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::RefineFrontierBoard() {
   stable.SynchroniseStateKnown();
 
   frontier.state.TransferStable(stable);
@@ -716,6 +1189,9 @@ bool SearchState::RefineFrontier() {
     return false;
   }
 
+  // SetForced only touches the frontier cells
+  staleColumns = frontier.frontierCells.PopulatedColumns();
+
   auto [consistent, changed] = SetForced(frontier);
   if (!consistent) {
     return false;
@@ -724,55 +1200,251 @@ bool SearchState::RefineFrontier() {
   return true;
 }
 
-std::pair<unsigned, std::pair<int, int>> SearchState::ChooseBranchCell() const {
-  // unsigned stopGen = std::min(frontier.size, maxBranchingGens);
-
-  // Prefer unknown stable cells?
-  // Prefer lower numbers of possible transitions?
-  // Prefer cells where all options are active?
-  // for (unsigned i = 0; i < generations.size(); i++) {
-  //   std::pair<int, int> branchCell = generations[i].frontierCells.FirstOn();
-  //   if (branchCell.first != -1) {
-  //     auto allowedTransitions = ::AllowedTransitions(generations[i], stable, branchCell);
-  //     if ((allowedTransitions & Transition::STABLE_TO_STABLE) != Transition::STABLE_TO_STABLE)
-  //     // if(TransitionCount(allowedTransitions) <= 3)
-  //       return {i, branchCell};
-  //   }
-  // }
-  // for (unsigned i = frontier.start; i < frontier.start + stopGen; i++) {
-  //   auto &g = frontier.generations[i];
-  //   auto branchCell = g.frontierCells.FirstOn();
-  //   if (branchCell.first != -1)
-  //     return {i, branchCell};
-  // }
+// Narrow `candidates` to the cells with the highest value of the
+// bit-sliced count `bits`, most significant first
+LifeState HighestCount(LifeState candidates, std::initializer_list<const LifeState *> bits) {
+  for (auto b : bits) {
+    LifeState narrowed = candidates & *b;
+    if (!narrowed.IsEmpty())
+      candidates = narrowed;
+  }
+  return candidates;
+}
 
-  LifeState remainingCells = frontier.frontierCells;
-  for (auto cell = remainingCells.FirstOn(); cell != std::make_pair(-1, -1);
-       remainingCells.Erase(cell), cell = remainingCells.FirstOn()) {
-    auto allowedTransitions = frontier.AllowedTransitions(stable, cell);
-    if(TransitionCount(allowedTransitions) <= 2)
-      return {0, cell};
+// The frontier cells in the same region as the last branch cell,
+// where regions are groups of frontier and unknown active cells whose
+// ZOIs touch. Branching stays in one region until it is resolved,
+// rather than interleaving the choices of unrelated regions. This
+// only reorders the search; the regions are not searched separately.
+template <uint32_t windowMax, uint32_t streakMax>
+LifeState SearchState<windowMax, streakMax>::FocusedRegion() const {
+  if (lastBranchCell.first == -1)
+    return frontier.frontierCells;
+
+  LifeState undetermined = frontier.frontierCells |
+    (frontier.state.unknown & ~frontier.state.unknownStable);
+  LifeState seed;
+  seed.Set(lastBranchCell);
+  LifeState region = undetermined.ComponentContaining(seed) & frontier.frontierCells;
+
+  if (region.IsEmpty())
+    return frontier.frontierCells;
+
+  if (stats != nullptr && region != frontier.frontierCells)
+    stats->regionSplits.fetch_add(1, std::memory_order_relaxed);
+
+  return region;
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+std::pair<unsigned, std::pair<int, int>> SearchState<windowMax, streakMax>::ChooseBranchCell() const {
+  if (frontier.frontierCells.IsEmpty())
+    return {0, {-1, -1}};
+
+  LifeState cells = params->regionOrder ? FocusedRegion() : frontier.frontierCells;
+
+  LifeState candidates;
+
+  switch (params->branchHeuristic) {
+  case BranchHeuristic::DEFAULT: {
+    // The first cell with at most 2 allowed transitions
+    TransitionPlanes allowed = frontier.AllowedTransitionPlanes(stable);
+    LifeState atLeastThree =
+        (allowed.offToOff & allowed.offToOn & (allowed.onToOff | allowed.onToOn)) |
+        (allowed.onToOff & allowed.onToOn & (allowed.offToOff | allowed.offToOn));
+    candidates = cells & ~atLeastThree;
+    break;
+  }
+
+  case BranchHeuristic::FEWEST_TRANSITIONS: {
+    // Fewest branches once the transitions are simplified, where
+    // OFF_TO_OFF and ON_TO_ON together become STABLE_TO_STABLE
+    TransitionPlanes allowed = frontier.AllowedTransitionPlanes(stable);
+    LifeState unchanging = allowed.offToOff | allowed.onToOn;
+    candidates = cells & ~(allowed.offToOn & allowed.onToOff & unchanging);
+    break;
+  }
+
+  case BranchHeuristic::MOST_CONSTRAINED: {
+    // Most stable options ruled out, summed bit-sliced
+    NeighbourCount ruledOut;
+    for (auto plane : {&stable.live2, &stable.live3, &stable.dead0, &stable.dead1,
+                       &stable.dead2, &stable.dead4, &stable.dead5, &stable.dead6}) {
+      LifeState carry0 = ruledOut.bit0 & *plane;
+      ruledOut.bit0 ^= *plane;
+      LifeState carry1 = ruledOut.bit1 & carry0;
+      ruledOut.bit1 ^= carry0;
+      LifeState carry2 = ruledOut.bit2 & carry1;
+      ruledOut.bit2 ^= carry1;
+      ruledOut.bit3 |= carry2;
+    }
+    candidates = HighestCount(cells,
+                              {&ruledOut.bit3, &ruledOut.bit2, &ruledOut.bit1, &ruledOut.bit0});
+    break;
+  }
+
+  case BranchHeuristic::SEMI_FRONTIER: {
+    // Most semi-frontier cells in the ZOI
+    NeighbourCount count(frontier.semiFrontier);
+    candidates = HighestCount(cells,
+                              {&count.bit3, &count.bit2, &count.bit1, &count.bit0});
+    break;
+  }
   }
 
-  auto branchCell = frontier.frontierCells.FirstOn();
-  if (branchCell.first != -1)
-    return {0, branchCell};
+  auto branchCell = candidates.FirstOn();
+  if (branchCell.first == -1)
+    branchCell = cells.FirstOn();
+
+#ifdef DEBUG
+  if (params->branchHeuristic == BranchHeuristic::DEFAULT) {
+    std::pair<int, int> expected = cells.FirstOn();
+    LifeState remainingCells = cells;
+    for (auto cell = remainingCells.FirstOn(); cell != std::make_pair(-1, -1);
+         remainingCells.Erase(cell), cell = remainingCells.FirstOn()) {
+      auto allowedTransitions = frontier.AllowedTransitions(stable, cell);
+      if (TransitionCount(allowedTransitions) <= 2) {
+        expected = cell;
+        break;
+      }
+    }
+    assert(branchCell == expected);
+  }
+#endif
+
+  return {0, branchCell};
+}
+
+// Shards split the tree by a hash of the branch choices taken to reach
+// depth `shardDepth`, every shard searches the whole tree above that.
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::BranchInShard(unsigned branchIndex) const {
+  if (params->shardCount <= 1 || depth + 1 != params->shardDepth)
+    return true;
+
+  uint64_t hash = branchIndex;
+  for (auto b : branchPath)
+    hash = HASH::hash64(hash, b);
+  return hash % params->shardCount == params->shardIndex;
+}
+
+// Everything that determines the subtree below this node
+template <uint32_t windowMax, uint32_t streakMax>
+uint64_t SearchState<windowMax, streakMax>::Hash() const {
+  // The words of a plane are mixed independently rather than chained
+  // as in GetHash, which keeps this cheap enough to do at every node
+  uint64_t result = 0;
+  auto mix = [&](const LifeState &s) {
+    uint64_t planeHash = 0;
+    for (unsigned i = 0; i < N; i++)
+      planeHash += HASH::_wymix(s[i] ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull * (2 * i + 1));
+    result = HASH::hash64(result, planeHash);
+  };
+  auto mixStable = [&](const LifeStableState &s) {
+    mix(s.state); mix(s.unknown);
+    mix(s.live2); mix(s.live3);
+    mix(s.dead0); mix(s.dead1); mix(s.dead2); mix(s.dead4); mix(s.dead5); mix(s.dead6);
+  };
+  auto mixUnknown = [&](const LifeUnknownState &s) {
+    mix(s.state); mix(s.unknown); mix(s.unknownStable);
+  };
+
+  mixStable(stable);
+  // Solutions record the stable state at the interaction
+  if (hasInteracted)
+    mixStable(*stableAtInteraction);
+  mix(lastTest.bit3); mix(lastTest.bit2); mix(lastTest.bit1); mix(lastTest.bit0);
+
+  mixUnknown(frontier.state);
+  mixUnknown(frontier.next);
+  mix(frontier.frontierCells);
+  mix(frontier.semiFrontier);
+  mix(frontier.active);
+  mix(frontier.changes);
+  mix(frontier.forcedInactive);
+  mix(frontier.forcedUnchanging);
+
+  mix(everActive);
+  mix(activeTimer.started);
+  mix(activeTimer.finished);
+  for (auto &c : activeTimer.counter)
+    mix(c);
+  mix(streakTimer.started);
+  mix(streakTimer.finished);
+  for (auto &c : streakTimer.counter)
+    mix(c);
+
+  result = HASH::hash64(result, frontier.gen);
+  result = HASH::hash64(result, currentGen);
+  result = HASH::hash64(result, timeSincePropagate);
+  result = HASH::hash64(result, hasTested);
+  result = HASH::hash64(result, hasInteracted);
+  result = HASH::hash64(result, interactionStart);
+  result = HASH::hash64(result, recoveredTime);
+  return result;
+}
+
+// When resuming, the siblings before the checkpoint path are done
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::BranchFinished(unsigned branchIndex) const {
+  return replaying && branchIndex < params->resumePath[depth];
+}
 
-  return {0, {-1, -1}};
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::BranchReplaying(unsigned branchIndex) const {
+  return replaying && depth + 1 < params->resumePath.size() &&
+         branchIndex == params->resumePath[depth];
 }
 
-void SearchState::SearchStep() {
+template <uint32_t windowMax, uint32_t streakMax>
+const std::vector<uint8_t> &SearchState<windowMax, streakMax>::Position() const {
+  return replaying ? params->resumePath : branchPath;
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchState<windowMax, streakMax>::SaveCheckpoint() {
+  std::vector<uint8_t> watermark = worker != nullptr ? worker->pool->Watermark() : Position();
+
+  std::vector<Solution> finished;
+  auto lock = LockResults();
+  for (auto &s : *allSolutions) {
+    if (s.branchPath < watermark)
+      finished.push_back(s);
+  }
+  checkpoint->Save(watermark, finished);
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::PrepareBranch(BranchPoint &branch) {
 #ifdef DEBUG
   if (params->hasOracle) {
     if (!stable.CompatibleWith(params->oracle))
-      return;
+      return false;
   }
 #endif
 
-  if(frontier.frontierCells.IsEmpty() || timeSincePropagate >= maxBranchFastCount){
+  if (stats != nullptr)
+    stats->nodes.fetch_add(1, std::memory_order_relaxed);
+
+  // Above the shard split and while replaying a checkpoint, the subtree
+  // searched from a node depends on its path, not just its state
+  if (transpositions != nullptr && !replaying &&
+      (params->shardCount == 1 || depth >= params->shardDepth)) {
+    if (transpositions->Visit(Hash(), depth))
+      return false;
+  }
+
+  if (checkpoint != nullptr) {
+    if (worker != nullptr)
+      worker->SetPosition(Position());
+    if (checkpoint->Due())
+      SaveCheckpoint();
+  }
+
+  if(frontier.frontierCells.IsEmpty() || timeSincePropagate >= params->branchFastCount){
     bool consistent = CalculateFrontier();
     if (!consistent)
-      return;
+      return false;
     timeSincePropagate = 0;
 
     stable.SanityCheck();
@@ -782,12 +1454,12 @@ void SearchState::SearchStep() {
 
     bool consistent = RefineFrontier();
     if (!consistent)
-      return;
+      return false;
 
     if (frontier.frontierCells.IsEmpty()) {
       bool consistent = CalculateFrontier();
       if (!consistent)
-        return;
+        return false;
       timeSincePropagate = 0;
     }
   }
@@ -795,6 +1467,9 @@ void SearchState::SearchStep() {
   auto [i, branchCell] = ChooseBranchCell();
   assert(branchCell.first != -1);
 
+  if (params->branchProbeCells > 0)
+    return ProbeBranchCells(branchCell, branch);
+
   stable.SynchroniseStateKnown(branchCell);
   frontier.state.TransferStable(stable, branchCell);
 
@@ -804,100 +1479,304 @@ void SearchState::SearchStep() {
   assert(allowedTransitions != Transition::IMPOSSIBLE);
   assert(!TransitionIsSingleton(allowedTransitions));
 
-  // Loop over the possible transitions
-  for (auto transition = TransitionHighest(allowedTransitions);
-       !TransitionIsSingleton(allowedTransitions);
-       allowedTransitions &= ~transition, transition = TransitionHighest(allowedTransitions)) {
+  branch = {branchCell, allowedTransitions, 0};
+  return true;
+}
 
-    auto newoptions = stable.GetOptions(branchCell) & OptionsFor(frontier.state, branchCell, transition);
+// Try a transition without committing to it: whether it survives
+// PropagateStrip and leaves every frontier cell in the strip with a
+// possible transition, and how many unknown stable cells it determines
+template <uint32_t windowMax, uint32_t streakMax>
+std::pair<bool, unsigned> SearchState<windowMax, streakMax>::ProbeTransition(std::pair<int, int> cell, Transition transition) {
+  auto newoptions = stable.GetOptions(cell) & OptionsFor(frontier.state, cell, transition);
+  if (newoptions == StableOptions::IMPOSSIBLE)
+    return {false, 0};
+
+  LifeStableTrail trail;
+  stable.SaveStrip(trail, cell.first);
+  LifeUnknownState savedState = frontier.state;
+
+  stable.RestrictOptions(cell, newoptions);
+  stable.SynchroniseStateKnown(cell);
+  bool consistent = stable.PropagateStrip(cell.first).consistent;
+
+  unsigned determined = 0;
+  if (consistent) {
+    frontier.state.TransferStable(stable);
+
+    LifeState strip;
+    for (unsigned i = 0; i < 6; i++)
+      strip[(cell.first + i + N - 2) % N] = ~0ULL;
+
+    LifeState toCheck = frontier.frontierCells & strip;
+    toCheck.Erase(cell);
+    for (auto other = toCheck.FirstOn(); consistent && other.first != -1;
+         toCheck.Erase(other), other = toCheck.FirstOn()) {
+      auto options = StableOptions::IMPOSSIBLE;
+      auto remaining = frontier.AllowedTransitions(stable, other);
+      for (auto t = TransitionHighest(remaining); remaining != Transition::IMPOSSIBLE;
+           remaining &= ~t, t = TransitionHighest(remaining))
+        options |= OptionsFor(frontier.state, other, t);
+      consistent = (options & stable.GetOptions(other)) != StableOptions::IMPOSSIBLE;
+    }
 
-    if (newoptions == StableOptions::IMPOSSIBLE)
-      continue;
+    determined = (savedState.unknownStable & ~stable.unknown & strip).GetPop();
+  }
 
-    SearchState newSearch = *this;
-    newSearch.stable.RestrictOptions(branchCell, newoptions);
-    newSearch.stable.SynchroniseStateKnown(branchCell);
+  stable.Rollback(trail);
+  frontier.state = savedState;
+  return {consistent, determined};
+}
+
+// Probe up to `branch-probe-cells` frontier cells, starting with the
+// one the heuristic prefers, and branch on the one with the fewest
+// transitions that survive. Ties go to the one that determines the
+// most cells. The failing transitions are dropped.
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::ProbeBranchCells(std::pair<int, int> preferred, BranchPoint &branch) {
+  bool found = false;
+  unsigned bestCount = 0;
+  unsigned bestDetermined = 0;
+
+  LifeState remainingCells = frontier.frontierCells;
+  remainingCells.Erase(preferred);
+  auto cell = preferred;
+  for (unsigned probed = 0; probed < params->branchProbeCells && cell.first != -1; probed++) {
+    stable.SynchroniseStateKnown(cell);
+    frontier.state.TransferStable(stable, cell);
+
+    auto allowedTransitions = TransitionSimplify(frontier.AllowedTransitions(stable, cell));
+    auto surviving = Transition::IMPOSSIBLE;
+    unsigned determined = 0;
+
+    auto remaining = allowedTransitions;
+    for (auto transition = TransitionHighest(remaining); remaining != Transition::IMPOSSIBLE;
+         remaining &= ~transition, transition = TransitionHighest(remaining)) {
+      auto [consistent, transitionDetermined] = ProbeTransition(cell, transition);
+      if (consistent) {
+        surviving |= transition;
+        determined += transitionDetermined;
+      }
+    }
+
+    // Every transition fails, so this node does
+    if (surviving == Transition::IMPOSSIBLE)
+      return false;
+
+    unsigned count = TransitionCount(surviving);
+    if (!found || count < bestCount || (count == bestCount && determined > bestDetermined)) {
+      found = true;
+      bestCount = count;
+      bestDetermined = determined;
+      branch = {cell, surviving, 0};
+    }
+
+    cell = remainingCells.FirstOn();
+    if (cell.first != -1)
+      remainingCells.Erase(cell);
+  }
+
+  return true;
+}
+
+// Whether a learned nogood shows that the branch fails PropagateStrip,
+// so the state need not be copied for it
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::BranchRefuted(std::pair<int, int> branchCell, Transition transition) const {
+  if (nogoods == nullptr)
+    return false;
+
+  auto newoptions = stable.GetOptions(branchCell) & OptionsFor(frontier.state, branchCell, transition);
+  if (!nogoods->Refutes(stable, branchCell, newoptions))
+    return false;
+
+#ifdef DEBUG
+  LifeStableState check = stable;
+  check.RestrictOptions(branchCell, newoptions);
+  check.SynchroniseStateKnown(branchCell);
+  assert(!check.PropagateStrip(branchCell.first).consistent);
+#endif
+
+  stats->nogoodRefutations.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+// Called on a copy of the node that chose `branchCell`
+template <uint32_t windowMax, uint32_t streakMax>
+bool SearchState<windowMax, streakMax>::ApplyBranch(std::pair<int, int> branchCell, Transition transition, unsigned branchIndex) {
+  auto newoptions = stable.GetOptions(branchCell) & OptionsFor(frontier.state, branchCell, transition);
+
+  if (newoptions == StableOptions::IMPOSSIBLE)
+    return false;
+
+  bool isPerturbation = frontier.state.TransitionIsPerturbation(branchCell, transition);
+  if (isPerturbation && !hasInteracted)
+    *stableAtInteraction = stable;
+
+  std::optional<NogoodWindow> window;
+  if (nogoods != nullptr)
+    window = NogoodWindow::Around(stable, branchCell, newoptions);
+
+  replaying = BranchReplaying(branchIndex);
+  depth++;
+  if (tracksPath)
+    branchPath.push_back(branchIndex);
+  lastBranchCell = branchCell;
+  stable.RestrictOptions(branchCell, newoptions);
+  stable.SynchroniseStateKnown(branchCell);
+
+  auto propagateResult = stable.PropagateStrip(branchCell.first);
+  if (!propagateResult.consistent) {
+    if (nogoods != nullptr && nogoods->Learn(*window, NogoodStore::Key(*window)))
+      stats->nogoodsLearned.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  staleColumns |= std::rotl(0x3FULL, (branchCell.first + N - 2) % N);
+
+  frontier.frontierCells.Erase(branchCell);
+  frontier.SetTransition(branchCell, transition);
+
+  if (isPerturbation) {
+    if(transition == Transition::OFF_TO_ON || transition == Transition::ON_TO_OFF)
+      everActive.Set(branchCell);
+
+    if (!hasInteracted) {
+      hasInteracted = true;
+      interactionStart = currentGen;
+    }
+  }
+
+  return true;
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchState<windowMax, streakMax>::SearchStep() {
+  BranchPoint branch;
+  if (!PrepareBranch(branch))
+    return;
+
+  // Loop over the possible transitions
+  for (auto transition = TransitionHighest(branch.remaining);
+       !TransitionIsSingleton(branch.remaining);
+       branch.remaining &= ~transition, transition = TransitionHighest(branch.remaining), branch.index++) {
 
-    auto propagateResult = newSearch.stable.PropagateStrip(branchCell.first);
-    if (!propagateResult.consistent)
+    if (!BranchInShard(branch.index) || BranchFinished(branch.index))
       continue;
 
-    newSearch.frontier.frontierCells.Erase(branchCell);
-    newSearch.frontier.SetTransition(branchCell, transition);
+    if (BranchRefuted(branch.cell, transition))
+      continue;
 
-    if (frontier.state.TransitionIsPerturbation(branchCell, transition)) {
-      if(transition == Transition::OFF_TO_ON || transition == Transition::ON_TO_OFF)
-        newSearch.everActive.Set(branchCell);
+    SearchState newSearch = *this;
+    if (!newSearch.ApplyBranch(branch.cell, transition, branch.index))
+      continue;
 
-      if (!hasInteracted) {
-        newSearch.hasInteracted = true;
-        newSearch.interactionStart = currentGen;
-        *stableAtInteraction = stable;
-      }
+    if (worker != nullptr && worker->ShouldSpawn()) {
+      worker->Push(newSearch);
+      continue;
     }
 
     newSearch.SearchStep();
   }
-  // TODO: move body to a function, make sure it becomes a tail call correctly
-  {
-    auto transition = allowedTransitions;
 
-    auto newoptions = stable.GetOptions(branchCell) & OptionsFor(frontier.state, branchCell, transition);
+  if (!BranchInShard(branch.index) || BranchFinished(branch.index))
+    return;
+
+  if (!ApplyBranch(branch.cell, branch.remaining, branch.index))
+    return;
+
+  [[clang::musttail]]
+  return SearchStep();
+}
+
+template <typename State>
+void SearchStack<State>::Run(const State &root) {
+  frames[0].search = root;
+  if (!frames[0].search.PrepareBranch(frames[0].branch))
+    return;
+
+  unsigned depth = 0;
+  while (true) {
+    if (frames[depth].branch.remaining == Transition::IMPOSSIBLE) {
+      if (depth == 0)
+        return;
+      depth--;
+      continue;
+    }
 
-    if (newoptions == StableOptions::IMPOSSIBLE)
-      return;
+    if (depth + 1 == frames.size())
+      frames.resize(2 * frames.size());
 
-    SearchState &newSearch = *this;
-    newSearch.stable.RestrictOptions(branchCell, newoptions);
-    newSearch.stable.SynchroniseStateKnown(branchCell);
+    SearchFrame<State> &frame = frames[depth];
+    SearchFrame<State> &child = frames[depth + 1];
 
-    auto propagateResult = newSearch.stable.PropagateStrip(branchCell.first);
-    if (!propagateResult.consistent)
-      return;
+    Transition transition = TransitionHighest(frame.branch.remaining);
+    frame.branch.remaining &= ~transition;
+    unsigned branchIndex = frame.branch.index++;
 
-    newSearch.frontier.frontierCells.Erase(branchCell);
-    newSearch.frontier.SetTransition(branchCell, transition);
+    if (!frame.search.BranchInShard(branchIndex) || frame.search.BranchFinished(branchIndex))
+      continue;
 
-    if (frontier.state.TransitionIsPerturbation(branchCell, transition)) {
-      if(transition == Transition::OFF_TO_ON || transition == Transition::ON_TO_OFF)
-        newSearch.everActive.Set(branchCell);
+    if (frame.search.BranchRefuted(frame.branch.cell, transition))
+      continue;
 
-      if (!hasInteracted) {
-        newSearch.hasInteracted = true;
-        newSearch.interactionStart = currentGen;
-        *stableAtInteraction = stable;
-      }
+    child.search = frame.search;
+    if (!child.search.ApplyBranch(frame.branch.cell, transition, branchIndex))
+      continue;
+
+    SearchWorker<State> *worker = child.search.worker;
+    if (worker != nullptr && worker->ShouldSpawn()) {
+      worker->Push(child.search);
+      continue;
     }
 
-    [[clang::musttail]]
-    return newSearch.SearchStep();
+    if (!child.search.PrepareBranch(child.branch))
+      continue;
+
+    depth++;
   }
 }
 
-SearchState::SearchState(SearchParams &inparams,
-                         std::vector<Solution> &outsolutions,
-                         std::set<std::string> &outrotors,
-                         LifeStableState &inStableAtInteraction)
+template <uint32_t windowMax, uint32_t streakMax>
+SearchState<windowMax, streakMax>::SearchState(SearchParams &inparams,
+                                               std::vector<Solution> &outsolutions,
+                                               std::set<std::string> &outrotors,
+                                               LifeStableState &inStableAtInteraction)
     : currentGen{0}, hasInteracted{false}, interactionStart{0} {
   params = &inparams;
   allSolutions = &outsolutions;
   seenRotors = &outrotors;
   stableAtInteraction = &inStableAtInteraction;
+  worker = nullptr;
+  checkpoint = nullptr;
+  stats = nullptr;
+  transpositions = nullptr;
+  nogoods = nullptr;
+  probePool = nullptr;
+  probeCache = nullptr;
+  replaying = !params->resumePath.empty();
+  depth = 0;
+  tracksPath = params->shardCount > 1 || params->checkpointFile != "" || replaying;
+  lastBranchCell = {-1, -1};
 
   stable = inparams.stable;
+  hasTested = false;
+  staleColumns = ~0ULL;
   frontier.state = inparams.startingState;
   frontier.next = frontier.state.StepMaintaining(stable);
 
   timeSincePropagate = 0;
+  lookaheadGens = params->lookaheadGens;
+  idleLookaheads = 0;
 
   everActive = LifeState();
-  activeTimer = LifeCountdown<maxCellActiveWindowGens>(params->maxCellActiveWindowGens);
-  streakTimer = LifeCountdown<maxCellActiveStreakGens>(params->maxCellActiveStreakGens);
+  activeTimer = WindowCountdown(params->maxCellActiveWindowGens);
+  streakTimer = StreakCountdown(params->maxCellActiveStreakGens);
 
   TryAdvance();
 }
 
-void SearchState::PrintSolution(const Solution &solution) {
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchState<windowMax, streakMax>::PrintSolution(const Solution &solution) {
   std::cout << "Winner:" << std::endl;
   std::cout << "x = 0, y = 0, rule = LifeBellman" << std::endl;
   LifeState state = params->startingState.state | solution.stable.state;
@@ -923,10 +1802,21 @@ void SearchState::PrintSolution(const Solution &solution) {
   }
 }
 
-void SearchState::RecordOscillator() {
+template <uint32_t windowMax, uint32_t streakMax>
+std::unique_lock<std::mutex> SearchState<windowMax, streakMax>::LockResults() const {
+  if (worker == nullptr)
+    return std::unique_lock<std::mutex>();
+  return std::unique_lock<std::mutex>(worker->pool->resultsMutex);
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchState<windowMax, streakMax>::RecordOscillator() {
   unsigned period = DeterminePeriod(frontier.state, stable);
   if (period >= params->reportOscillatorsMinPeriod) {
-    std::cout << "Oscillating! Period: " << period << std::endl;
+    {
+      auto lock = LockResults();
+      std::cout << "Oscillating! Period: " << period << std::endl;
+    }
 
     if(!(everActive.ZOI() & stable.unknown).IsEmpty()) {
       auto [result, completed] = stable.CompleteStable(
@@ -940,23 +1830,41 @@ void SearchState::RecordOscillator() {
 
     for(auto &r : GetSeparatedRotorDesc(frontier.state, stable, period)) {
       auto rotorDesc = r.ToString();
-      if (seenRotors->contains(rotorDesc))
-        std::cout << "Known Rotor: " << rotorDesc << std::endl;
-      else {
-        seenRotors->insert(rotorDesc);
-        std::cout << "New Rotor: " << rotorDesc << std::endl;
-        RecordSolution();
+      bool isNew;
+      {
+        auto lock = LockResults();
+        isNew = !seenRotors->contains(rotorDesc);
+        if (isNew) {
+          seenRotors->insert(rotorDesc);
+          std::cout << "New Rotor: " << rotorDesc << std::endl;
+        } else {
+          std::cout << "Known Rotor: " << rotorDesc << std::endl;
+        }
       }
+      if (isNew)
+        RecordSolution(rotorDesc);
     }
   }
 }
 
-void SearchState::RecordSolution() {
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchState<windowMax, streakMax>::RecordSolution(const std::string &rotor) {
+  if (replaying)
+    return;
+
+  // Solutions above the shard depth are found by every shard, leave
+  // them to the first one
+  if (params->shardCount > 1 && depth < params->shardDepth &&
+      params->shardIndex != 0)
+    return;
+
   Solution solution;
   solution.stable = stable;
   solution.interactionStable = *stableAtInteraction;
   solution.interactionGen = interactionStart;
   solution.recoveryGen = currentGen - params->minStableInterval + 1;
+  solution.branchPath = branchPath;
+  solution.rotor = rotor;
 
   if (params->stabiliseResults) {
     std::tie(solution.completionResult, solution.completed) = stable.CompleteStable(params->stabiliseResultsTimeout, params->minimiseResults);
@@ -967,13 +1875,15 @@ void SearchState::RecordSolution() {
 
   solution.state = (stable.state | startingActive | solution.completed) & ~startingStableOff;
 
+  auto lock = LockResults();
   allSolutions->push_back(solution);
 
   if (!params->metasearch)
     PrintSolution(solution);
 }
 
-void SearchState::SanityCheck() {
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchState<windowMax, streakMax>::SanityCheck() {
 #ifdef DEBUG
   frontier.state.SanityCheck(stable);
   assert((stable.state & stable.unknown).IsEmpty());
@@ -994,6 +1904,393 @@ void SearchState::SanityCheck() {
 #endif
 }
 
+template <typename State>
+bool SearchWorker<State>::ShouldSpawn() const {
+  return pool->idle.load(std::memory_order_relaxed) > queued.load(std::memory_order_relaxed);
+}
+
+template <typename State>
+void SearchWorker<State>::Push(const State &search) {
+  pool->pending++;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back({search, search.hasInteracted ? stableAtInteraction : LifeStableState()});
+    queued++;
+  }
+  pool->Wake(false);
+}
+
+template <typename State>
+std::optional<SearchTask<State>> SearchWorker<State>::Pop() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (tasks.empty())
+    return std::nullopt;
+  std::optional<SearchTask<State>> task = std::move(tasks.back());
+  tasks.pop_back();
+  queued--;
+  busy = true;
+  position = task->search.Position();
+  return task;
+}
+
+template <typename State>
+std::optional<SearchTask<State>> SearchWorker<State>::Steal() {
+  for (auto &victim : pool->workers) {
+    if (&victim == this || victim.queued.load(std::memory_order_relaxed) == 0)
+      continue;
+
+    // The task has to stay visible to Watermark() while it moves over
+    std::scoped_lock lock(victim.mutex, mutex);
+    if (victim.tasks.empty())
+      continue;
+    std::optional<SearchTask<State>> task = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    victim.queued--;
+    busy = true;
+    position = task->search.Position();
+    return task;
+  }
+  return std::nullopt;
+}
+
+template <typename State>
+void SearchWorker<State>::Run(SearchTask<State> &task) {
+  stableAtInteraction = task.stableAtInteraction;
+  task.search.stableAtInteraction = &stableAtInteraction;
+  task.search.worker = this;
+  if (task.search.nogoods != nullptr)
+    task.search.nogoods = &nogoods;
+  if (probePool)
+    task.search.probePool = &*probePool;
+  RunSearch(task.search, stack);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  busy = false;
+}
+
+template <typename State>
+void SearchWorker<State>::SetPosition(const std::vector<uint8_t> &newPosition) {
+  std::lock_guard<std::mutex> lock(mutex);
+  position = newPosition;
+}
+
+template <typename State>
+void SearchWorker<State>::Loop() {
+  bool isIdle = false;
+  while (pool->pending != 0) {
+    std::optional<SearchTask<State>> task = Pop();
+    if (!task)
+      task = Steal();
+
+    if (!task) {
+      if (!isIdle) {
+        pool->idle++;
+        isIdle = true;
+      }
+      pool->WaitForWork();
+      continue;
+    }
+
+    if (isIdle) {
+      pool->idle--;
+      isIdle = false;
+    }
+
+    Run(*task);
+    if (--pool->pending == 0)
+      pool->Wake(true);
+  }
+  if (isIdle)
+    pool->idle--;
+}
+
+template <typename State>
+SearchPool<State>::SearchPool(unsigned threads)
+    : workers(threads), pending{0}, idle{0} {
+  for (auto &w : workers) {
+    w.pool = this;
+    w.queued = 0;
+    w.busy = false;
+  }
+}
+
+// Taking the lock orders the notification after the check in
+// WaitForWork, so a worker that is about to sleep cannot miss it
+template <typename State>
+void SearchPool<State>::Wake(bool all) {
+  { std::lock_guard<std::mutex> lock(wakeMutex); }
+  if (all)
+    wake.notify_all();
+  else
+    wake.notify_one();
+}
+
+template <typename State>
+void SearchPool<State>::WaitForWork() {
+  std::unique_lock<std::mutex> lock(wakeMutex);
+  wake.wait(lock, [&] {
+    if (pending == 0)
+      return true;
+    for (auto &w : workers) {
+      if (w.queued.load(std::memory_order_relaxed) != 0)
+        return true;
+    }
+    return false;
+  });
+}
+
+// Everything before the earliest node that is being searched or is
+// waiting in a deque has been finished
+template <typename State>
+std::vector<uint8_t> SearchPool<State>::Watermark() {
+  std::vector<std::unique_lock<std::mutex>> locks;
+  for (auto &w : workers)
+    locks.emplace_back(w.mutex);
+
+  std::optional<std::vector<uint8_t>> result;
+  auto consider = [&](const std::vector<uint8_t> &path) {
+    if (!result || path < *result)
+      result = path;
+  };
+  for (auto &w : workers) {
+    if (w.busy)
+      consider(w.position);
+    for (auto &t : w.tasks)
+      consider(t.search.Position());
+  }
+
+  if (!result)
+    return {std::numeric_limits<uint8_t>::max()};
+  return *result;
+}
+
+SearchCheckpoint::SearchCheckpoint(const std::string &infilename, unsigned intervalSecs)
+    : filename{infilename}, interval{std::chrono::seconds(intervalSecs)} {
+  nextSave = (std::chrono::steady_clock::now() + interval).time_since_epoch().count();
+}
+
+bool SearchCheckpoint::Due() {
+  auto now = std::chrono::steady_clock::now();
+  auto due = nextSave.load(std::memory_order_relaxed);
+  if (now.time_since_epoch().count() < due)
+    return false;
+  return nextSave.compare_exchange_strong(due, (now + interval).time_since_epoch().count());
+}
+
+void SearchCheckpoint::Save(const std::vector<uint8_t> &watermark,
+                            const std::vector<Solution> &solutions) const {
+  // Write to the side first so that a crash never leaves a partial checkpoint
+  std::string tempname = filename + ".tmp";
+  {
+    std::ofstream out(tempname);
+    out << "checkpoint " << watermark.size();
+    for (auto b : watermark)
+      out << " " << static_cast<unsigned>(b);
+    out << std::endl;
+    for (auto &s : solutions)
+      s.Write(out);
+  }
+  std::rename(tempname.c_str(), filename.c_str());
+}
+
+bool SearchCheckpoint::Load(const std::string &filename,
+                            std::vector<uint8_t> &watermark,
+                            std::vector<Solution> &solutions,
+                            std::set<std::string> &rotors) {
+  std::ifstream in(filename);
+  std::string header;
+  unsigned length;
+  if (!(in >> header >> length) || header != "checkpoint")
+    return false;
+
+  watermark.clear();
+  for (unsigned i = 0; i < length; i++) {
+    unsigned b;
+    in >> b;
+    watermark.push_back(b);
+  }
+
+  while (auto s = Solution::Read(in)) {
+    if (!s->rotor.empty())
+      rotors.insert(s->rotor);
+    solutions.push_back(*s);
+  }
+
+  return true;
+}
+
+// Once the search has finished there is nothing left to resume
+void SearchCheckpoint::Remove() const {
+  std::remove(filename.c_str());
+}
+
+template <typename State>
+void SearchPool<State>::Run(const State &root) {
+  workers[0].stableAtInteraction = *root.stableAtInteraction;
+  workers[0].Push(root);
+
+  // The root state is only handed to the workers, so only they probe
+  if (root.params->testUnknowns && root.params->testUnknownsThreads > 1) {
+    for (auto &w : workers)
+      w.probePool.emplace(root.params->testUnknownsThreads, root.probeCache);
+  }
+
+  std::vector<std::thread> threads;
+  for (auto &w : workers)
+    threads.emplace_back(&SearchWorker<State>::Loop, &w);
+  for (auto &t : threads)
+    t.join();
+}
+
+void PrintStats(const SearchParams &params, const SearchStats &stats,
+                const TranspositionTable *transpositions,
+                const ProbeCache *probeCache,
+                std::chrono::duration<double> elapsed) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  long peakKB = usage.ru_maxrss / 1024;
+#else
+  long peakKB = usage.ru_maxrss;
+#endif
+
+  std::string engine = params.engine == SearchEngine::ITERATIVE ? "iterative" : "recursive";
+  std::cout << "Search stats: engine " << engine
+            << ", " << stats.nodes << " nodes in " << elapsed.count() << "s"
+            << " (" << static_cast<uint64_t>(stats.nodes / elapsed.count()) << " nodes/s)"
+            << ", peak RSS " << peakKB / 1024 << "MB" << std::endl;
+
+  if (params.nogoods) {
+    std::cout << "Nogood store: " << stats.nogoodsLearned << " learned, "
+              << stats.nogoodRefutations << " branches refuted" << std::endl;
+  }
+
+  if (params.regionOrder) {
+    std::cout << "Region order: " << stats.regionSplits
+              << " nodes with the frontier split into regions" << std::endl;
+  }
+
+  if (params.adaptiveLookahead.first != -1) {
+    std::cout << "Adaptive lookahead: " << stats.lookaheads << " lookaheads, "
+              << (stats.lookaheads == 0 ? 0 : (double)stats.lookaheadGenerations / stats.lookaheads)
+              << " generations on average" << std::endl;
+  }
+
+  if (transpositions != nullptr) {
+    uint64_t lookups = transpositions->lookups;
+    uint64_t hits = transpositions->hits;
+    std::cout << "Transposition table: " << hits << " hits in " << lookups << " lookups"
+              << " (" << (lookups == 0 ? 0 : 100.0 * hits / lookups) << "%)"
+              << ", " << transpositions->evictions << " evictions"
+              << ", " << transpositions->Capacity() << " entries" << std::endl;
+  }
+
+  if (probeCache != nullptr) {
+    uint64_t lookups = probeCache->lookups;
+    uint64_t hits = probeCache->hits;
+    std::cout << "Probe cache: " << hits << " hits in " << lookups << " lookups"
+              << " (" << (lookups == 0 ? 0 : 100.0 * hits / lookups) << "%)"
+              << ", " << probeCache->Capacity() << " entries" << std::endl;
+  }
+}
+
+template <uint32_t windowMax, uint32_t streakMax>
+void SearchWith(SearchParams &params, std::vector<Solution> &allSolutions,
+                std::set<std::string> &seenRotors) {
+  using State = SearchState<windowMax, streakMax>;
+
+  LifeStableState stableAtInteraction;
+  State search(params, allSolutions, seenRotors, stableAtInteraction);
+
+  SearchStats stats;
+  stats.nodes = 0;
+  stats.nogoodsLearned = 0;
+  stats.nogoodRefutations = 0;
+  stats.regionSplits = 0;
+  stats.lookaheads = 0;
+  stats.lookaheadGenerations = 0;
+  search.stats = &stats;
+
+  NogoodStore nogoods;
+  if (params.nogoods)
+    search.nogoods = &nogoods;
+
+  std::optional<ProbeCache> probeCache;
+  if (params.testUnknowns && params.probeCacheMB > 0) {
+    probeCache.emplace(params.probeCacheMB);
+    search.probeCache = &*probeCache;
+  }
+
+  // With several search threads, each worker has a pool of its own
+  std::optional<ProbePool> probePool;
+  if (params.testUnknowns && params.testUnknownsThreads > 1 && params.threads == 1) {
+    probePool.emplace(params.testUnknownsThreads, search.probeCache);
+    search.probePool = &*probePool;
+  }
+
+  std::optional<TranspositionTable> transpositions;
+  if (params.transpositionTableMB > 0) {
+    transpositions.emplace(params.transpositionTableMB, params.transpositionReplacement);
+    search.transpositions = &*transpositions;
+  }
+  auto start = std::chrono::steady_clock::now();
+
+  std::optional<SearchCheckpoint> checkpoint;
+  if (params.checkpointFile != "" && !params.metasearch) {
+    checkpoint.emplace(params.checkpointFile, params.checkpointInterval);
+    search.checkpoint = &*checkpoint;
+  }
+
+  if (params.threads > 1) {
+    SearchPool<State> pool(params.threads);
+    pool.Run(search);
+  } else {
+    SearchStack<State> stack;
+    RunSearch(search, stack);
+  }
+
+  if (checkpoint)
+    checkpoint->Remove();
+
+  if (params.printSummary)
+    PrintStats(params, stats, transpositions ? &*transpositions : nullptr,
+               probeCache ? &*probeCache : nullptr,
+               std::chrono::steady_clock::now() - start);
+}
+
+// The largest countdown each instantiation of the search supports, so
+// that a run only pays for the counter bits it uses
+constexpr std::array<uint32_t, 4> countdownBuckets = {0, 3, 15, 255};
+
+using SearchFunction = void (*)(SearchParams &, std::vector<Solution> &,
+                                std::set<std::string> &);
+
+template <uint32_t windowMax>
+constexpr std::array<SearchFunction, countdownBuckets.size()> searchRow = {
+    &SearchWith<windowMax, countdownBuckets[0]>,
+    &SearchWith<windowMax, countdownBuckets[1]>,
+    &SearchWith<windowMax, countdownBuckets[2]>,
+    &SearchWith<windowMax, countdownBuckets[3]>};
+
+constexpr std::array<std::array<SearchFunction, countdownBuckets.size()>, countdownBuckets.size()>
+    searchTable = {searchRow<countdownBuckets[0]>, searchRow<countdownBuckets[1]>,
+                   searchRow<countdownBuckets[2]>, searchRow<countdownBuckets[3]>};
+
+// The smallest bucket that can count `gens`, where -1 is unused
+unsigned CountdownBucket(int gens) {
+  unsigned i = 0;
+  while (gens > (int)countdownBuckets[i])
+    i++;
+  return i;
+}
+
+void Search(SearchParams &params, std::vector<Solution> &allSolutions,
+            std::set<std::string> &seenRotors) {
+  SearchFunction search = searchTable[CountdownBucket(params.maxCellActiveWindowGens)]
+                                     [CountdownBucket(params.maxCellActiveStreakGens)];
+  search(params, allSolutions, seenRotors);
+}
+
 void PrintSummary(std::vector<Solution> &pats, std::ostream &out) {
   out << "x = 0, y = 0, rule = B3/S23" << std::endl;
   for (unsigned i = 0; i < pats.size(); i += 8) {
@@ -1111,14 +2408,12 @@ std::vector<Solution> TrimSolutions(SearchParams &params, std::vector<Solution>
 void MetaSearchStep(unsigned round, std::vector<Solution> &allSolutions, SearchParams &params) {
   std::vector<Solution> roundSolutions;
   std::set<std::string> seenRotors;
-  LifeStableState stableAtInteraction;
 
   std::cerr << "Depth: " << round << std::endl;
   std::cerr << "x = 0, y = 0, rule = LifeBellman" << std::endl;
   std::cerr << LifeBellmanRLEFor(params.stable.state | params.startingState.state, params.stable.unknown | params.stable.state) << std::endl;
 
-  SearchState search(params, roundSolutions, seenRotors, stableAtInteraction);
-  search.SearchStep();
+  Search(params, roundSolutions, seenRotors);
 
   auto trimmed = TrimSolutions(params, roundSolutions);
 
@@ -1169,24 +2464,137 @@ void MetaSearch(SearchParams &params) {
   }
 }
 
-int main(int, char *argv[]) {
+void PrintResults(SearchParams &params, std::vector<Solution> &allSolutions) {
+  if (!params.printSummary)
+    return;
+
+  std::cout << "All solutions:" << std::endl;
+  PrintSummary(allSolutions);
+
+  if(params.trimResults) {
+    std::cout << "Unique perturbations:" << std::endl;
+    auto trimmed = TrimSolutions(params, allSolutions);
+    PrintSummary(trimmed);
+    allSolutions = trimmed;
+  }
+
+  if(!params.filters.empty()) {
+    std::vector<Solution> filtered;
+    for (auto &s : allSolutions) {
+      if (PassesFilters(params, s))
+        filtered.push_back(s);
+    }
+    std::cout << "Filtered:" << std::endl;
+    PrintSummary(filtered);
+  }
+}
+
+void WriteSolutions(const std::string &filename, const std::vector<Solution> &solutions) {
+  std::ofstream out(filename);
+  for (auto &s : solutions)
+    s.Write(out);
+}
+
+std::vector<Solution> ReadSolutions(const std::string &filename) {
+  std::ifstream in(filename);
+  if (!in) {
+    std::cout << "Could not read solutions file " << filename << std::endl; exit(1);
+  }
+
+  std::vector<Solution> result;
+  while (auto s = Solution::Read(in))
+    result.push_back(*s);
+  return result;
+}
+
+// Combine the solution files written by each shard. Sorting by the
+// branch path puts the solutions back in the order a single process
+// would have found them.
+void MergeShards(SearchParams &params, const std::vector<std::string> &filenames) {
+  std::vector<Solution> allSolutions;
+  for (auto &f : filenames) {
+    auto solutions = ReadSolutions(f);
+    allSolutions.insert(allSolutions.end(), solutions.begin(), solutions.end());
+  }
+
+  // Sort indices rather than the solutions themselves, stable_sort's
+  // scratch buffer does not respect the alignment of LifeState
+  std::vector<unsigned> order(allSolutions.size());
+  for (unsigned i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+    return allSolutions[a].branchPath < allSolutions[b].branchPath;
+  });
+
+  // As in a single process, only the first solution for each rotor
+  std::vector<Solution> sorted;
+  std::set<std::string> seenRotors;
+  for (auto i : order) {
+    const std::string &rotor = allSolutions[i].rotor;
+    if (!rotor.empty() && !seenRotors.insert(rotor).second)
+      continue;
+    sorted.push_back(allSolutions[i]);
+  }
+
+  PrintResults(params, sorted);
+}
+
+int main(int argc, char *argv[]) {
   auto toml = toml::parse(argv[1]);
+
+  // `--set key=value` overrides a top-level parameter of the input,
+  // the argument is itself parsed as TOML
+  for (int i = 2; i + 1 < argc; i++) {
+    if (std::string(argv[i]) != "--set")
+      continue;
+    std::istringstream in(argv[++i]);
+    auto override = toml::parse(in, "--set");
+    for (auto &[key, value] : override.as_table())
+      toml.as_table()[key] = value;
+  }
+
   SearchParams params = SearchParams::FromToml(toml);
 
-  if (params.maxCellActiveWindowGens != -1 &&
-  (unsigned)params.maxCellActiveWindowGens > maxCellActiveWindowGens) {
-    std::cout << "max-cell-active-window is higher than allowed by the hardcoded value!" << std::endl; exit(1);
+  std::vector<std::string> mergeFiles;
+  bool resume = false;
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--shard" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%u/%u", &params.shardIndex, &params.shardCount) != 2 ||
+          params.shardIndex >= params.shardCount) {
+        std::cout << "--shard expects i/n with i < n" << std::endl; exit(1);
+      }
+    } else if (arg == "--solutions" && i + 1 < argc) {
+      params.solutionsFile = argv[++i];
+    } else if (arg == "--set" && i + 1 < argc) {
+      i++; // Already applied
+    } else if (arg == "--resume") {
+      resume = true;
+    } else if (arg == "--merge") {
+      mergeFiles.assign(argv + i + 1, argv + argc);
+      break;
+    } else {
+      std::cout << "Unknown argument " << arg << std::endl; exit(1);
+    }
+  }
+
+  if (params.shardCount > 1 && params.solutionsFile == "")
+    params.solutionsFile = std::string(argv[1]) + ".shard-" + std::to_string(params.shardIndex) +
+                           "-of-" + std::to_string(params.shardCount);
+
+  if (params.maxCellActiveWindowGens > (int)countdownBuckets.back()) {
+    std::cout << "max-cell-active-window is higher than " << countdownBuckets.back() << std::endl; exit(1);
   }
-  if (params.maxCellActiveStreakGens != -1 &&
-  (unsigned)params.maxCellActiveStreakGens > maxCellActiveStreakGens) {
-    std::cout << "max-cell-active-streak is higher than allowed by the hardcoded value!" << std::endl; exit(1);
+  if (params.maxCellActiveStreakGens > (int)countdownBuckets.back()) {
+    std::cout << "max-cell-active-streak is higher than " << countdownBuckets.back() << std::endl; exit(1);
   }
 
-  if (params.metasearch) {
+  if (!mergeFiles.empty()) {
+    MergeShards(params, mergeFiles);
+  } else if (params.metasearch) {
     MetaSearch(params);
   } else {
     std::vector<Solution> allSolutions;
-    LifeStableState stableAtInteraction;
 
     std::set<std::string> seenRotors;
     if(params.reportOscillators) {
@@ -1194,29 +2602,19 @@ int main(int, char *argv[]) {
       seenRotors.insert(r);
     }
 
-    SearchState search(params, allSolutions, seenRotors, stableAtInteraction);
-    search.SearchStep();
+    if (resume) {
+      if (params.checkpointFile == "" ||
+          !SearchCheckpoint::Load(params.checkpointFile, params.resumePath, allSolutions, seenRotors)) {
+        std::cout << "--resume needs a readable checkpoint-file" << std::endl; exit(1);
+      }
+      std::cout << "Resuming with " << allSolutions.size() << " solutions" << std::endl;
+    }
 
-    if (params.printSummary) {
-      std::cout << "All solutions:" << std::endl;
-      PrintSummary(allSolutions);
+    Search(params, allSolutions, seenRotors);
 
-      if(params.trimResults) {
-        std::cout << "Unique perturbations:" << std::endl;
-        auto trimmed = TrimSolutions(params, allSolutions);
-        PrintSummary(trimmed);
-        allSolutions = trimmed;
-      }
+    if (params.solutionsFile != "")
+      WriteSolutions(params.solutionsFile, allSolutions);
 
-      if(!params.filters.empty()) {
-        std::vector<Solution> filtered;
-        for (auto &s : allSolutions) {
-          if (PassesFilters(params, s))
-            filtered.push_back(s);
-        }
-        std::cout << "Filtered:" << std::endl;
-        PrintSummary(filtered);
-      }
-    }
+    PrintResults(params, allSolutions);
   }
 }
@@ -0,0 +1,131 @@
+// Compares the plane-per-option layout of LifeStableState with one
+// that interleaves the ten planes column by column, as LifeStableTrail
+// stores them. The strip kernels read a few columns of every plane,
+// which the interleaved layout keeps together, and the whole-board
+// kernels work through one plane at a time, which it spreads out.
+//
+// It also compares copying the state with copying only the eight
+// option planes. The state and unknown planes follow from the options
+// once SynchroniseStateKnown has run, so a compact copy has to
+// rebuild them before the kernels can use it.
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "LifeAPI.h"
+#include "LifeStableState.hpp"
+
+const unsigned repeats = 10000000;
+
+template <typename F>
+double NanosecondsPer(F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned r = 0; r < repeats; r++)
+    f(r);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+int main() {
+  LifeStableState stable;
+  for (unsigned i = 0; i < N; i++) {
+    stable.state[i] = i * 0x9E3779B97F4A7C15ULL;
+    stable.unknown[i] = ~stable.state[i] >> 3;
+    stable.live2[i] = stable.state[i] >> 5;
+    stable.dead0[i] = stable.unknown[i] << 7;
+  }
+
+  LifeStableTrail interleaved;
+  stable.SnapshotColumns(interleaved, ~0ULL);
+
+  uint64_t sink = 0;
+
+  // What the *Strip kernels gather around a column
+  double planeStrip = NanosecondsPer([&](unsigned r) {
+    unsigned column = (r * 7) % N;
+    auto state = stable.state.GetStrip<6>(column);
+    auto unknown = stable.unknown.GetStrip<6>(column);
+    std::array<std::array<uint64_t, 4>, 8> options = {
+        stable.live2.GetStrip<4>(column), stable.live3.GetStrip<4>(column),
+        stable.dead0.GetStrip<4>(column), stable.dead1.GetStrip<4>(column),
+        stable.dead2.GetStrip<4>(column), stable.dead4.GetStrip<4>(column),
+        stable.dead5.GetStrip<4>(column), stable.dead6.GetStrip<4>(column)};
+    asm volatile("" : : "r"(&state), "r"(&unknown), "r"(&options) : "memory");
+    sink += state[r % 6] ^ options[r % 8][r % 4];
+  });
+
+  double interleavedStrip = NanosecondsPer([&](unsigned r) {
+    unsigned column = (r * 7) % N;
+    std::array<std::array<uint64_t, 10>, 6> strip;
+    for (unsigned i = 0; i < 6; i++)
+      strip[i] = interleaved.columns[(column + i + N - 2) % N];
+    asm volatile("" : : "r"(&strip) : "memory");
+    sink += strip[r % 6][r % 10];
+  });
+
+  // The cells whose options rule out every dead count, as in
+  // SynchroniseStateKnown
+  double planeBoard = NanosecondsPer([&](unsigned r) {
+    LifeState result = stable.dead0 & stable.dead1 & stable.dead2 &
+                       stable.dead4 & stable.dead5 & stable.dead6;
+    asm volatile("" : : "r"(&result) : "memory");
+    sink += result[r % N];
+  });
+
+  double interleavedBoard = NanosecondsPer([&](unsigned r) {
+    LifeState result;
+    for (unsigned i = 0; i < N; i++) {
+      const std::array<uint64_t, 10> &c = interleaved.columns[i];
+      result[i] = c[4] & c[5] & c[6] & c[7] & c[8] & c[9];
+    }
+    asm volatile("" : : "r"(&result) : "memory");
+    sink += result[r % N];
+  });
+
+  // A copy per branch, and the same with the options alone
+  LifeStableState copy;
+  double fullCopy = NanosecondsPer([&](unsigned r) {
+    asm volatile("" : : : "memory");
+    copy = stable;
+    asm volatile("" : : "r"(&copy) : "memory");
+    sink += copy.state[r % N];
+  });
+
+  std::array<LifeState, 8> compact;
+  double compactCopy = NanosecondsPer([&](unsigned r) {
+    asm volatile("" : : : "memory");
+    compact[0] = stable.live2;
+    compact[1] = stable.live3;
+    compact[2] = stable.dead0;
+    compact[3] = stable.dead1;
+    compact[4] = stable.dead2;
+    compact[5] = stable.dead4;
+    compact[6] = stable.dead5;
+    compact[7] = stable.dead6;
+    asm volatile("" : : "r"(&compact) : "memory");
+    sink += compact[r % 8][r % N];
+  });
+
+  double compactDecode = NanosecondsPer([&](unsigned r) {
+    asm volatile("" : : : "memory");
+    LifeState maybeLive = ~(compact[0] & compact[1]);
+    LifeState maybeDead = ~(compact[2] & compact[3] & compact[4] &
+                            compact[5] & compact[6] & compact[7]);
+    copy.state = maybeLive & ~maybeDead;
+    copy.unknown = maybeLive & maybeDead;
+    asm volatile("" : : "r"(&copy) : "memory");
+    sink += copy.unknown[r % N];
+  });
+
+  std::cout << "                 planes  interleaved" << std::endl;
+  std::cout << "strip gather   " << std::setw(8) << planeStrip << "ns  " << std::setw(9) << interleavedStrip << "ns" << std::endl;
+  std::cout << "board kernel   " << std::setw(8) << planeBoard << "ns  " << std::setw(9) << interleavedBoard << "ns" << std::endl;
+
+  std::cout << std::endl;
+  std::cout << "copy of ten planes      " << std::setw(8) << fullCopy << "ns" << std::endl;
+  std::cout << "copy of eight planes    " << std::setw(8) << compactCopy << "ns" << std::endl;
+  std::cout << "rebuild state, unknown  " << std::setw(8) << compactDecode << "ns" << std::endl;
+
+  return sink == 0xdeadbeef;
+}
@@ -40,6 +40,31 @@ struct PropagateResult {
   bool changed;
 };
 
+// Columns of a LifeStableState saved before a speculative change, so
+// that it can be rolled back without copying every plane
+struct LifeStableTrail {
+  uint64_t saved = 0;
+  std::array<std::array<uint64_t, 10>, N> columns;
+};
+
+// How far each cell has been narrowed down: the number of options
+// ruled out, plus one if the cell is known. Along a branch the options
+// only shrink, so a cell has changed exactly when its count has, and
+// the counts fit in four planes rather than the ten of a copy.
+struct StableRefinement {
+  LifeState bit3;
+  LifeState bit2;
+  LifeState bit1;
+  LifeState bit0;
+
+  bool operator==(const StableRefinement&) const = default;
+
+  LifeState Differences(const StableRefinement &other) const {
+    return (bit3 ^ other.bit3) | (bit2 ^ other.bit2) |
+           (bit1 ^ other.bit1) | (bit0 ^ other.bit0);
+  }
+};
+
 enum struct CompletionResult {
   COMPLETED,
   INCONSISTENT,
@@ -82,6 +107,7 @@ public:
   }
 
   LifeStableState Join(const LifeStableState &other) const;
+  void JoinColumns(const LifeStableTrail &other);
   LifeStableState Graft(const LifeStableState &other) const;
   LifeStableState ClearUnmodified() const;
   LifeState Differences(const LifeStableState &other) const;
@@ -107,10 +133,13 @@ public:
 
   PropagateResult SynchroniseStateKnown();
   PropagateResult UpdateOptions(); // Assumes counts and state/unknown are in sync
+  PropagateResult UpdateOptions(const NeighbourCount &stateCount);
   PropagateResult StabiliseOptions(); // Apply the above two repeatedly
 
   PropagateResult SignalNeighbours(); // Assumes counts and state/unknown are in sync
+  PropagateResult SignalNeighbours(const NeighbourCount &stateCount);
   PropagateResult PropagateStep();
+  PropagateResult PropagateBoard(); // Repeat PropagateStep until nothing changes
   PropagateResult Propagate();
 
   std::pair<uint64_t, uint64_t> SynchroniseStateKnownColumn(unsigned column);
@@ -132,6 +161,20 @@ public:
     return perturbed & unknown;
   }
   LifeState Vulnerable() const;
+  LifeState Vulnerable(uint64_t columns) const; // Only correct on `columns`
+  StableRefinement Refinement() const;
+
+  void SaveColumn(LifeStableTrail &trail, unsigned column) const;
+  void RestoreColumn(const LifeStableTrail &trail, unsigned column);
+  // The columns that the *Strip functions may modify
+  void SaveStrip(LifeStableTrail &trail, unsigned column) const;
+  void Rollback(LifeStableTrail &trail);
+  bool ChangedSince(const LifeStableTrail &trail) const;
+  // Overwrite the given columns of the trail, rather than keeping the
+  // first copy
+  void SnapshotColumns(LifeStableTrail &trail, uint64_t columns) const;
+  // The columns that differ from the trail, or that it lacks
+  uint64_t ChangedColumns(const LifeStableTrail &trail) const;
 
   PropagateResult TestUnknown(std::pair<int, int> cell);
   PropagateResult TestUnknowns(const LifeState &cells);
@@ -177,6 +220,27 @@ LifeStableState LifeStableState::Join(const LifeStableState &other) const {
   return result;
 }
 
+// Join with the saved columns of `other`, which must agree with this
+// state everywhere else
+void LifeStableState::JoinColumns(const LifeStableTrail &other) {
+  for (uint64_t remaining = other.saved; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    const std::array<uint64_t, 10> &c = other.columns[i];
+
+    unknown[i] |= c[1] | (state[i] ^ c[0]);
+    state[i] &= ~unknown[i];
+
+    live2[i] &= c[2];
+    live3[i] &= c[3];
+    dead0[i] &= c[4];
+    dead1[i] &= c[5];
+    dead2[i] &= c[6];
+    dead4[i] &= c[7];
+    dead5[i] &= c[8];
+    dead6[i] &= c[9];
+  }
+}
+
 LifeStableState LifeStableState::Graft(const LifeStableState &other) const {
   LifeStableState result;
 
@@ -297,32 +361,39 @@ void LifeStableState::SetOff(std::pair<int, int> cell) {
 }
 
 LifeState LifeStableState::Vulnerable() const {
+  return Vulnerable(~0ULL);
+}
+
+LifeState LifeStableState::Vulnerable(uint64_t columns) const {
   NeighbourCount stateCount(state);
   NeighbourCount unknownCount(unknown);
 
-  LifeState new_vulnerable_on(false);
-  LifeState new_vulnerable_off(false);
-  LifeState new_vulnerable_center_on(false);
-  LifeState new_vulnerable_center_off(false);
-
-  for (int i = 0; i < N; i++) {
-    uint64_t l2 = live2[i];
-    uint64_t l3 = live3[i];
-    uint64_t d0 = dead0[i];
-    uint64_t d1 = dead1[i];
-    uint64_t d2 = dead2[i];
-    uint64_t d4 = dead4[i];
-    uint64_t d5 = dead5[i];
-    uint64_t d6 = dead6[i];
-
-    uint64_t s2 = stateCount.bit2[i];
-    uint64_t s1 = stateCount.bit1[i];
-    uint64_t s0 = stateCount.bit0[i];
+  LifeState new_vulnerable_on;
+  LifeState new_vulnerable_off;
+  LifeState new_vulnerable_center_on;
+  LifeState new_vulnerable_center_off;
 
-    uint64_t unk3 = unknownCount.bit3[i];
-    uint64_t unk2 = unknownCount.bit2[i];
-    uint64_t unk1 = unknownCount.bit1[i];
-    uint64_t unk0 = unknownCount.bit0[i];
+  uint64_t nearby = columns | std::rotl(columns, 1) | std::rotr(columns, 1);
+  for (auto s : StripIterator(nearby)) {
+  #pragma clang loop vectorize_width(4)
+  for (int i = 0; i < 4; i++) {
+    uint64_t l2 = live2[s][i];
+    uint64_t l3 = live3[s][i];
+    uint64_t d0 = dead0[s][i];
+    uint64_t d1 = dead1[s][i];
+    uint64_t d2 = dead2[s][i];
+    uint64_t d4 = dead4[s][i];
+    uint64_t d5 = dead5[s][i];
+    uint64_t d6 = dead6[s][i];
+
+    uint64_t s2 = stateCount.bit2[s][i];
+    uint64_t s1 = stateCount.bit1[s][i];
+    uint64_t s0 = stateCount.bit0[s][i];
+
+    uint64_t unk3 = unknownCount.bit3[s][i];
+    uint64_t unk2 = unknownCount.bit2[s][i];
+    uint64_t unk1 = unknownCount.bit1[s][i];
+    uint64_t unk0 = unknownCount.bit0[s][i];
 
     uint64_t vulnerable_on = 0;
     uint64_t vulnerable_off = 0;
@@ -333,10 +404,11 @@ LifeState LifeStableState::Vulnerable() const {
 #include "bitslicing/stable_vulnerable.hpp"
     // End Autogenerated
 
-    new_vulnerable_on[i] = vulnerable_on;
-    new_vulnerable_off[i] = vulnerable_off;
-    new_vulnerable_center_on[i] = vulnerable_center_on;
-    new_vulnerable_center_off[i] = vulnerable_center_off;
+    new_vulnerable_on[s][i] = vulnerable_on;
+    new_vulnerable_off[s][i] = vulnerable_off;
+    new_vulnerable_center_on[s][i] = vulnerable_center_on;
+    new_vulnerable_center_off[s][i] = vulnerable_center_off;
+  }
   }
 
   LifeState on = new_vulnerable_on.ZOIHollow() | new_vulnerable_center_on;
@@ -344,6 +416,21 @@ LifeState LifeStableState::Vulnerable() const {
   return on & off;
 }
 
+StableRefinement LifeStableState::Refinement() const {
+  LifeState a0, a1, b0, b1, c0, c1;
+  FullAdd(a0, a1, ~unknown, live2, live3);
+  FullAdd(b0, b1, dead0, dead1, dead2);
+  FullAdd(c0, c1, dead4, dead5, dead6);
+
+  StableRefinement result;
+  LifeState twos, fours0, fours1;
+  FullAdd(result.bit0, twos, a0, b0, c0);
+  FullAdd(a0, fours0, a1, b1, c1);
+  HalfAdd(result.bit1, fours1, a0, twos);
+  HalfAdd(result.bit2, result.bit3, fours0, fours1);
+  return result;
+}
+
 PropagateResult LifeStableState::PropagateSimpleStep() {
   LifeState startUnknown = unknown;
 
@@ -489,7 +576,10 @@ PropagateResult LifeStableState::SynchroniseStateKnown() {
 }
 
 PropagateResult LifeStableState::UpdateOptions() {
-  NeighbourCount stateCount(state);
+  return UpdateOptions(NeighbourCount(state));
+}
+
+PropagateResult LifeStableState::UpdateOptions(const NeighbourCount &stateCount) {
   NeighbourCount offCount(~unknown & ~state);
 
   uint64_t has_abort = 0;
@@ -548,7 +638,10 @@ PropagateResult LifeStableState::UpdateOptions() {
 }
 
 PropagateResult LifeStableState::SignalNeighbours() {
-  NeighbourCount stateCount(state);
+  return SignalNeighbours(NeighbourCount(state));
+}
+
+PropagateResult LifeStableState::SignalNeighbours(const NeighbourCount &stateCount) {
   NeighbourCount maxCount(state | unknown);
 
   LifeState new_signal_off(false), new_signal_on(false);
@@ -630,11 +723,15 @@ PropagateResult LifeStableState::PropagateStep() {
   if (!knownresult.consistent)
     return {false, false};
 
-  PropagateResult optionsresult = UpdateOptions();
+  // UpdateOptions only touches the options, so the counts of the
+  // state are shared with SignalNeighbours
+  NeighbourCount stateCount(state);
+
+  PropagateResult optionsresult = UpdateOptions(stateCount);
   if (!optionsresult.consistent)
     return {false, false};
 
-  PropagateResult signalresult = SignalNeighbours();
+  PropagateResult signalresult = SignalNeighbours(stateCount);
   if (!signalresult.consistent)
     return {false, false};
 
@@ -648,7 +745,7 @@ PropagateResult LifeStableState::PropagateStep() {
   return {true, changed};
 }
 
-PropagateResult LifeStableState::Propagate() {
+PropagateResult LifeStableState::PropagateBoard() {
   bool changedEver = false;
   bool done = false;
   while (!done) {
@@ -661,6 +758,50 @@ PropagateResult LifeStableState::Propagate() {
   return {true, changedEver};
 }
 
+// The same fixed point as PropagateBoard. After one step over the
+// whole board, only the strips next to a change are propagated again,
+// until none of them changes anything.
+PropagateResult LifeStableState::Propagate() {
+#ifdef DEBUG
+  LifeStableState reference = *this;
+  PropagateResult referenceResult = reference.PropagateBoard();
+#endif
+
+  LifeStableState before = *this;
+  PropagateResult result = PropagateStep();
+  if (!result.consistent || !result.changed)
+    return result;
+
+  // Columns whose cells need looking at again
+  uint64_t changed = Differences(before).PopulatedColumns();
+  uint64_t dirty = changed | std::rotl(changed, 1) | std::rotr(changed, 1);
+
+  while (dirty != 0) {
+    // The strip of the first dirty column and the three after it
+    unsigned column = (std::countr_zero(dirty) + 1) % N;
+    dirty &= ~std::rotl(0xFULL, (column + N - 1) % N);
+
+    LifeStableTrail trail;
+    SaveStrip(trail, column);
+
+    PropagateResult stripResult = PropagateStrip(column);
+    if (!stripResult.consistent)
+      return {false, false};
+
+    if (stripResult.changed) {
+      changed = ChangedColumns(trail) & trail.saved;
+      dirty |= changed | std::rotl(changed, 1) | std::rotr(changed, 1);
+    }
+  }
+
+#ifdef DEBUG
+  assert(referenceResult.consistent);
+  assert(Differences(reference).IsEmpty());
+#endif
+
+  return {true, true};
+}
+
 PropagateResult LifeStableState::PropagateSimpleStepStrip(unsigned column) {
   std::array<uint64_t, 6> nearbyState = state.GetStrip<6>(column);
   std::array<uint64_t, 6> nearbyUnknown = unknown.GetStrip<6>(column);
@@ -1140,13 +1281,88 @@ PropagateResult LifeStableState::PropagateStrip(unsigned column) {
   return {true, changedEver};
 }
 
+void LifeStableState::SaveColumn(LifeStableTrail &trail, unsigned i) const {
+  if (trail.saved & (1ULL << i))
+    return;
+  trail.saved |= 1ULL << i;
+  trail.columns[i] = {state[i], unknown[i], live2[i], live3[i], dead0[i],
+                      dead1[i], dead2[i], dead4[i], dead5[i], dead6[i]};
+}
+
+void LifeStableState::RestoreColumn(const LifeStableTrail &trail, unsigned i) {
+  const std::array<uint64_t, 10> &c = trail.columns[i];
+  state[i] = c[0];
+  unknown[i] = c[1];
+  live2[i] = c[2];
+  live3[i] = c[3];
+  dead0[i] = c[4];
+  dead1[i] = c[5];
+  dead2[i] = c[6];
+  dead4[i] = c[7];
+  dead5[i] = c[8];
+  dead6[i] = c[9];
+}
+
+void LifeStableState::SaveStrip(LifeStableTrail &trail, unsigned column) const {
+  for (unsigned i = 0; i < 6; i++)
+    SaveColumn(trail, (column + i + N - 2) % N);
+}
+
+void LifeStableState::Rollback(LifeStableTrail &trail) {
+  for (uint64_t remaining = trail.saved; remaining != 0; remaining &= remaining - 1)
+    RestoreColumn(trail, std::countr_zero(remaining));
+  trail.saved = 0;
+}
+
+bool LifeStableState::ChangedSince(const LifeStableTrail &trail) const {
+  for (uint64_t remaining = trail.saved; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    const std::array<uint64_t, 10> &c = trail.columns[i];
+    if (state[i] != c[0] || unknown[i] != c[1] || live2[i] != c[2] ||
+        live3[i] != c[3] || dead0[i] != c[4] || dead1[i] != c[5] ||
+        dead2[i] != c[6] || dead4[i] != c[7] || dead5[i] != c[8] ||
+        dead6[i] != c[9])
+      return true;
+  }
+  return false;
+}
+
+void LifeStableState::SnapshotColumns(LifeStableTrail &trail, uint64_t columns) const {
+  trail.saved &= ~columns;
+  for (uint64_t remaining = columns; remaining != 0; remaining &= remaining - 1)
+    SaveColumn(trail, std::countr_zero(remaining));
+}
+
+uint64_t LifeStableState::ChangedColumns(const LifeStableTrail &trail) const {
+  uint64_t result = ~trail.saved;
+  for (uint64_t remaining = trail.saved; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    const std::array<uint64_t, 10> &c = trail.columns[i];
+    uint64_t differences = (state[i] ^ c[0]) | (unknown[i] ^ c[1]) | (live2[i] ^ c[2]) |
+                           (live3[i] ^ c[3]) | (dead0[i] ^ c[4]) | (dead1[i] ^ c[5]) |
+                           (dead2[i] ^ c[6]) | (dead4[i] ^ c[7]) | (dead5[i] ^ c[8]) |
+                           (dead6[i] ^ c[9]);
+    if (differences != 0)
+      result |= 1ULL << i;
+  }
+  return result;
+}
+
+// A probe only reads and writes the six columns from two to the left
+// of the cell to three to the right, because PropagateStrip only
+// touches the strip around the cell. So each probe is undone by
+// restoring those columns rather than copying the state. ProbePool and
+// ProbeCache rely on this too.
 PropagateResult LifeStableState::TestUnknown(std::pair<int, int> cell) {
+  LifeStableTrail original;
+  SaveStrip(original, cell.first);
+
   // Try on
-  LifeStableState onSearch = *this;
-  onSearch.SetOn(cell);
-  auto onResult = onSearch.PropagateStrip(cell.first);
+  SetOn(cell);
+  auto onResult = PropagateStrip(cell.first);
 
   if (!onResult.consistent) {
+    Rollback(original);
     SetOff(cell);
     auto offResult = PropagateStrip(cell.first);
     if (!offResult.consistent)
@@ -1155,24 +1371,28 @@ PropagateResult LifeStableState::TestUnknown(std::pair<int, int> cell) {
       return {true, true};
   }
 
+  LifeStableTrail onSearch;
+  SaveStrip(onSearch, cell.first);
+  Rollback(original);
+
   // Try off
-  LifeStableState offSearch = *this;
-  offSearch.SetOff(cell);
-  auto offResult = offSearch.PropagateStrip(cell.first);
+  SaveStrip(original, cell.first);
+  SetOff(cell);
+  auto offResult = PropagateStrip(cell.first);
 
-  if (onResult.consistent && !offResult.consistent) {
-    *this = onSearch;
+  if (!offResult.consistent) {
+    Rollback(onSearch);
     return {true, true};
   }
 
-  if (onResult.consistent && offResult.consistent && onResult.changed && offResult.changed) {
-    LifeStableState joined = onSearch.Join(offSearch);
-    bool change = joined != *this;
-    *this = joined;
-    return {true, change};
+  if (onResult.changed && offResult.changed) {
+    // The off result is already in place
+    JoinColumns(onSearch);
+    return {true, ChangedSince(original)};
   }
 
-  return {true, false}; // Impossible
+  Rollback(original);
+  return {true, false};
 }
 
 PropagateResult LifeStableState::TestUnknowns(const LifeState &cells) {
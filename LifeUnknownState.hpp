@@ -22,14 +22,16 @@ public:
   }
 
   LifeUnknownState StepMaintaining(const LifeStableState &stable) const;
+  LifeUnknownState StepMaintaining(const LifeStableState &stable, const NeighbourCount &stableCount) const;
   std::tuple<uint64_t, uint64_t, uint64_t> StepMaintainingColumn(const LifeStableState &stable, int i) const;
-  std::tuple<std::array<uint64_t, 4>, std::array<uint64_t, 4>, std::array<uint64_t, 4>> StepMaintainingStrip(const LifeStableState &stable, int i) const;
+  bool StepKnown(const LifeStableState &stable);
 
   // bool CanCleanlyAdvance(const LifeStableState &stable) const;
   LifeState ActiveComparedTo(const LifeStableState &stable) const;
   LifeState ChangesComparedTo(const LifeUnknownState &prev) const;
   void TransferStable(const LifeStableState &stable);
   void TransferStable(const LifeStableState &stable, std::pair<int, int> cell);
+  void TransferStableColumns(const LifeStableState &stable, uint64_t columns);
 
   void SetKnown(std::pair<int, int> cell, bool value, bool stable) {
     if (stable) {
@@ -152,11 +154,16 @@ public:
 };
 
 LifeUnknownState LifeUnknownState::StepMaintaining(const LifeStableState &stable) const {
+  return StepMaintaining(stable, NeighbourCount(stable.state));
+}
+
+// `stableCount` is the NeighbourCount of `stable.state`, for callers
+// stepping several generations against the same stable state
+LifeUnknownState LifeUnknownState::StepMaintaining(const LifeStableState &stable, const NeighbourCount &stableCount) const {
   LifeUnknownState result{LifeState(false), LifeState(false), LifeState(false)};
 
   NeighbourCount stateCount(state);
   NeighbourCount unknownCount(unknown);
-  NeighbourCount stableCount(stable.state);
 
   LifeState nearUnstableUnknown = (unknown & ~unknownStable).ZOI();
   LifeState differentCountToStable = stateCount.bit3 |
@@ -310,106 +317,61 @@ std::tuple<uint64_t, uint64_t, uint64_t> LifeUnknownState::StepMaintainingColumn
   return {result_state, result_unknown, result_unknownStable};
 }
 
-std::tuple<std::array<uint64_t, 4>,
-           std::array<uint64_t, 4>,
-           std::array<uint64_t, 4>>
-LifeUnknownState::StepMaintainingStrip(const LifeStableState &stable, int column) const {
-  std::array<uint64_t, 4> resultState;
-  std::array<uint64_t, 4> resultUnknown;
-  std::array<uint64_t, 4> resultUnknownStable;
-
-  std::array<uint64_t, 6> nearbyState = state.GetStrip<6>(column);
-  std::array<uint64_t, 6> nearbyUnknown = unknown.GetStrip<6>(column);
-  std::array<uint64_t, 6> nearbyStableState = stable.state.GetStrip<6>(column);
-  std::array<uint64_t, 6> nearbyStableUnknown = stable.unknown.GetStrip<6>(column);
-
-  std::array<uint64_t, 4> nearbylive2 = stable.live2.GetStrip<4>(column);
-  std::array<uint64_t, 4> nearbylive3 = stable.live3.GetStrip<4>(column);
-  std::array<uint64_t, 4> nearbydead0 = stable.dead0.GetStrip<4>(column);
-  std::array<uint64_t, 4> nearbydead1 = stable.dead1.GetStrip<4>(column);
-  std::array<uint64_t, 4> nearbydead2 = stable.dead2.GetStrip<4>(column);
-  std::array<uint64_t, 4> nearbydead4 = stable.dead4.GetStrip<4>(column);
-  std::array<uint64_t, 4> nearbydead5 = stable.dead5.GetStrip<4>(column);
-  std::array<uint64_t, 4> nearbydead6 = stable.dead6.GetStrip<4>(column);
-
-  std::array<uint64_t, 4> state3, state2, state1, state0;
-  std::array<uint64_t, 4> unknown3, unknown2, unknown1, unknown0;
-  CountNeighbourhoodStrip(nearbyState, state3, state2, state1, state0);
-  CountNeighbourhoodStrip(nearbyUnknown, unknown3, unknown2, unknown1, unknown0);
-
-  std::array<uint64_t, 4> stable3, stable2, stable1, stable0;
-  CountNeighbourhoodStrip(nearbyStableState, stable3, stable2, stable1, stable0);
-
-  std::array<uint64_t, 4> diff3, diff2, diff1, diff0;
-  FourBitSubtract(stable3, stable2, stable1, stable0,
-                  state3, state2, state1, state0,
-                  diff3, diff2, diff1, diff0);
-
-  // TODO wasteful
-  LifeState unknownActive = unknown & ~unknownStable;
-  std::array<uint64_t, 4> useRefined;
-  for (int i = 1; i < 5; i++) {
-    int c = (column + i - 2 + N) % N;
-    useRefined[i-1] = ~unknownActive.ZOIColumn(c);
+// StepMaintaining in place, for a state that only differs from
+// `stable` on known cells at least two cells away from any unknown
+// cell. Those are stepped as an ordinary pattern and the rest already
+// matches `stable`, so only the columns near the differences are
+// visited. Returns false, leaving the state alone, if it is not like
+// that.
+bool LifeUnknownState::StepKnown(const LifeStableState &stable) {
+  LifeState different(false);
+  uint64_t mismatched = 0;
+  for (unsigned i = 0; i < N; i++) {
+    mismatched |= (unknown[i] ^ unknownStable[i]) | (unknown[i] & ~stable.unknown[i]);
+    different[i] = ~unknown[i] & (stable.unknown[i] | (state[i] ^ stable.state[i]));
+  }
+  if (mismatched != 0)
+    return false;
+  uint64_t columns = different.PopulatedColumns();
+
+  // The cells that may differ from `stable` next generation, and the
+  // cells those depend on
+  uint64_t regionColumns = columns | std::rotl(columns, 1) | std::rotr(columns, 1);
+  uint64_t nearColumns = regionColumns | std::rotl(regionColumns, 1) | std::rotr(regionColumns, 1);
+  for (uint64_t remaining = nearColumns; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    uint64_t near = different[(i + N - 2) % N] | different[(i + N - 1) % N] | different[i] |
+                    different[(i + 1) % N] | different[(i + 2) % N];
+    near |= std::rotl(near, 1) | std::rotr(near, 1);
+    near |= std::rotl(near, 1) | std::rotr(near, 1);
+    if ((near & unknown[i]) != 0)
+      return false;
   }
 
-  #pragma clang loop vectorize_width(4)
-  for (int i = 1; i < 5; i++) {
-    uint64_t on3 = state3[i-1];
-    uint64_t on2 = state2[i-1];
-    uint64_t on1 = state1[i-1];
-    uint64_t on0 = state0[i-1];
-
-    uint64_t unk3 = unknown3[i-1];
-    uint64_t unk2 = unknown2[i-1];
-    uint64_t unk1 = unknown1[i-1];
-    uint64_t unk0 = unknown0[i-1];
-
-    uint64_t current_on = nearbyState[i];
-    uint64_t current_unknown = nearbyUnknown[i];
-    uint64_t stable_on = nearbyStableState[i];
-    uint64_t stable_unknown = nearbyStableUnknown[i];
-
-    uint64_t naive_next_on = 0;
-    uint64_t naive_next_unknown = 0;
-
-    // Begin Autogenerated, see bitslicing/unknown_step.py
-#include "bitslicing/unknown_step.hpp"
-    // End Autogenerated
-
-    uint64_t l2 = nearbylive2[i-1];
-    uint64_t l3 = nearbylive3[i-1];
-    uint64_t d0 = nearbydead0[i-1];
-    uint64_t d1 = nearbydead1[i-1];
-    uint64_t d2 = nearbydead2[i-1];
-    uint64_t d4 = nearbydead4[i-1];
-    uint64_t d5 = nearbydead5[i-1];
-    uint64_t d6 = nearbydead6[i-1];
-
-    uint64_t m3 = diff3[i-1];
-    uint64_t m2 = diff2[i-1];
-    uint64_t m1 = diff1[i-1];
-    uint64_t m0 = diff0[i-1];
-
-    uint64_t next_on = 0;
-    uint64_t next_unknown = 0;
-    uint64_t next_unknown_stable = 0;
-
-    // Begin Autogenerated, see bitslicing/unknown_step_refined.py
-#include "bitslicing/unknown_step_refined_m.hpp"
-    // End Autogenerated
+#ifdef DEBUG
+  LifeUnknownState expected = StepMaintaining(stable);
+#endif
 
-    // Handle the DONTCAREs
-    next_unknown |= current_unknown;
-    next_on &= ~next_unknown;
-    next_unknown_stable &= current_unknown;
+  LifeState stepped(false);
+  for (uint64_t remaining = regionColumns; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    auto [bit3, bit2, bit1, bit0] = CountNeighbourhoodColumn(state, i);
+    // 3 in the neighbourhood, or 4 counting a live centre
+    stepped[i] = ~bit3 & ((~bit2 & bit1 & bit0) | (state[i] & bit2 & ~bit1 & ~bit0));
+  }
 
-    resultState[i-1] = (naive_next_on & ~useRefined[i-1]) | (next_on & useRefined[i-1]);
-    resultUnknown[i-1] = (naive_next_unknown & ~useRefined[i-1]) | (next_unknown & useRefined[i-1]);
-    resultUnknownStable[i-1] = (next_unknown_stable & useRefined[i-1]);
+  for (uint64_t remaining = regionColumns; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    uint64_t region = different.ZOIColumn(i);
+    state[i] = (stepped[i] & region) | (stable.state[i] & ~region);
+    unknown[i] &= ~region;
+    unknownStable[i] &= ~region;
   }
 
-  return {resultState, resultUnknown, resultUnknownStable};
+#ifdef DEBUG
+  assert(*this == expected);
+#endif
+  return true;
 }
 
 LifeState LifeUnknownState::ActiveComparedTo(const LifeStableState &stable) const {
@@ -423,6 +385,16 @@ void LifeUnknownState::TransferStable(const LifeStableState &stable) {
   unknownStable &= ~updated;
 }
 
+void LifeUnknownState::TransferStableColumns(const LifeStableState &stable, uint64_t columns) {
+  for (uint64_t remaining = columns; remaining != 0; remaining &= remaining - 1) {
+    unsigned i = std::countr_zero(remaining);
+    uint64_t updated = unknownStable[i] & ~stable.unknown[i];
+    state[i] |= stable.state[i] & updated;
+    unknown[i] &= ~updated;
+    unknownStable[i] &= ~updated;
+  }
+}
+
 void LifeUnknownState::TransferStable(const LifeStableState &stable, std::pair<int, int> cell) {
   bool updated = unknownStable.Get(cell) && !stable.unknown.Get(cell);
   if (updated) {
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "LifeAPI.h"
+#include "LifeStableState.hpp"
+
+// The restrictions of a LifeStableState in the strip PropagateStrip
+// looks at, relative to a branch cell: the cell is moved to column 2,
+// row 32. Every plane is "1 = ruled out", so a window is at least as
+// restrictive as another if it is a superset.
+struct NogoodWindow {
+  static constexpr unsigned width = 6;
+  static constexpr unsigned planes = 10; // known on, known off, then the options
+  static constexpr unsigned centerRow = 32;
+
+  std::array<std::array<uint64_t, planes>, width> columns;
+
+  static NogoodWindow Around(const LifeStableState &stable,
+                             std::pair<int, int> cell, StableOptions options);
+
+  bool Contains(const NogoodWindow &other) const;
+  void RestrictRows(unsigned radius);
+  LifeStableState Realise() const;
+};
+
+NogoodWindow NogoodWindow::Around(const LifeStableState &stable,
+                                  std::pair<int, int> cell,
+                                  StableOptions options) {
+  NogoodWindow result;
+  unsigned shift = (centerRow - cell.second + N) % N;
+  for (unsigned i = 0; i < width; i++) {
+    unsigned c = (cell.first + i + N - 2) % N;
+    std::array<uint64_t, planes> &col = result.columns[i];
+    col[0] = stable.state[c] & ~stable.unknown[c];
+    col[1] = ~stable.state[c] & ~stable.unknown[c];
+    col[2] = stable.live2[c];
+    col[3] = stable.live3[c];
+    col[4] = stable.dead0[c];
+    col[5] = stable.dead1[c];
+    col[6] = stable.dead2[c];
+    col[7] = stable.dead4[c];
+    col[8] = stable.dead5[c];
+    col[9] = stable.dead6[c];
+    for (auto &w : col)
+      w = std::rotl(w, shift);
+  }
+
+  // Apply the restriction of the branch cell, as RestrictOptions and
+  // SynchroniseStateKnown would
+  StableOptions allowed = stable.GetOptions(cell) & options;
+  uint64_t centerBit = 1ULL << centerRow;
+  std::array<uint64_t, planes> &col = result.columns[2];
+  if ((allowed & ~StableOptions::LIVE) == StableOptions::IMPOSSIBLE)
+    col[0] |= centerBit;
+  if ((allowed & ~StableOptions::DEAD) == StableOptions::IMPOSSIBLE)
+    col[1] |= centerBit;
+  for (unsigned j = 0; j < 8; j++) {
+    if ((static_cast<unsigned char>(allowed) & (1 << j)) == 0)
+      col[j + 2] |= centerBit;
+  }
+
+  return result;
+}
+
+bool NogoodWindow::Contains(const NogoodWindow &other) const {
+  uint64_t missing = 0;
+  for (unsigned i = 0; i < width; i++)
+    for (unsigned j = 0; j < planes; j++)
+      missing |= other.columns[i][j] & ~columns[i][j];
+  return missing == 0;
+}
+
+void NogoodWindow::RestrictRows(unsigned radius) {
+  uint64_t mask = 0;
+  for (unsigned r = centerRow - radius; r <= centerRow + radius && r < N; r++)
+    mask |= 1ULL << r;
+  for (auto &col : columns)
+    for (auto &w : col)
+      w &= mask;
+}
+
+// A state with only these restrictions, with the cell at (2, 32)
+LifeStableState NogoodWindow::Realise() const {
+  LifeStableState result;
+  result.unknown = ~LifeState();
+  for (unsigned i = 0; i < width; i++) {
+    const std::array<uint64_t, planes> &col = columns[i];
+    result.state[i] = col[0];
+    result.unknown[i] = ~(col[0] | col[1]);
+    result.live2[i] = col[2];
+    result.live3[i] = col[3];
+    result.dead0[i] = col[4];
+    result.dead1[i] = col[5];
+    result.dead2[i] = col[6];
+    result.dead4[i] = col[7];
+    result.dead5[i] = col[8];
+    result.dead6[i] = col[9];
+  }
+  return result;
+}
+
+// Windows that are known to make PropagateStrip fail, learned from
+// failed branches. They are checked before copying the search state
+// for a new branch, and shrunk to as few rows as still fail so that
+// they match elsewhere. Buckets are keyed on the options left at the
+// branch cell and keep the most recent nogoods.
+class NogoodStore {
+public:
+  static constexpr unsigned bucketCount = 256;
+  static constexpr unsigned bucketSize = 16;
+
+  struct Bucket {
+    std::vector<NogoodWindow> nogoods;
+    unsigned next = 0;
+  };
+
+  std::array<Bucket, bucketCount> buckets;
+
+  // The options left at the branch cell
+  static unsigned Key(const NogoodWindow &window) {
+    unsigned result = 0;
+    for (unsigned j = 0; j < 8; j++) {
+      if (((window.columns[2][j + 2] >> NogoodWindow::centerRow) & 1) == 0)
+        result |= 1 << j;
+    }
+    return result;
+  }
+
+  bool Refutes(const LifeStableState &stable, std::pair<int, int> cell,
+               StableOptions options) const;
+  bool Learn(const NogoodWindow &window, unsigned key);
+};
+
+bool NogoodStore::Refutes(const LifeStableState &stable,
+                          std::pair<int, int> cell,
+                          StableOptions options) const {
+  NogoodWindow window = NogoodWindow::Around(stable, cell, options);
+  const Bucket &bucket = buckets[Key(window)];
+  for (auto &n : bucket.nogoods) {
+    if (window.Contains(n))
+      return true;
+  }
+  return false;
+}
+
+// Called with the window of a branch whose PropagateStrip failed
+bool NogoodStore::Learn(const NogoodWindow &window, unsigned key) {
+  for (unsigned radius : {1, 2, 4, 8, 16, 32}) {
+    NogoodWindow candidate = window;
+    if (radius < 32)
+      candidate.RestrictRows(radius);
+
+    LifeStableState weakened = candidate.Realise();
+    if (weakened.PropagateStrip(2).consistent)
+      continue;
+
+    Bucket &bucket = buckets[key];
+    if (bucket.nogoods.size() < bucketSize) {
+      bucket.nogoods.push_back(candidate);
+    } else {
+      bucket.nogoods[bucket.next] = candidate;
+      bucket.next = (bucket.next + 1) % bucketSize;
+    }
+    return true;
+  }
+  return false;
+}
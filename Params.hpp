@@ -7,6 +7,7 @@
 #include "LifeUnknownState.hpp"
 #include "LifeStableState.hpp"
 #include "Parsing.hpp"
+#include "TranspositionTable.hpp"
 
 enum class FilterType {
   EXACT,
@@ -20,6 +21,18 @@ struct Filter {
   FilterType type;
 };
 
+enum class SearchEngine {
+  RECURSIVE,
+  ITERATIVE
+};
+
+enum class BranchHeuristic {
+  DEFAULT,
+  FEWEST_TRANSITIONS,
+  MOST_CONSTRAINED,
+  SEMI_FRONTIER
+};
+
 struct Forbidden {
   LifeState mask;
   LifeState state;
@@ -89,6 +102,35 @@ public:
   bool pipeResults;
   std::string outputFile;
 
+  unsigned threads;
+  SearchEngine engine;
+
+  unsigned transpositionTableMB;
+  ReplacementPolicy transpositionReplacement;
+
+  bool nogoods;
+
+  BranchHeuristic branchHeuristic;
+  unsigned branchProbeCells;
+  bool regionOrder;
+
+  unsigned lookaheadGens;
+  unsigned branchFastCount;
+  unsigned calculateRounds;
+  bool testUnknowns;
+  unsigned testUnknownsThreads;
+  unsigned probeCacheMB;
+  std::pair<int, int> adaptiveLookahead;
+
+  unsigned shardIndex;
+  unsigned shardCount;
+  unsigned shardDepth;
+  std::string solutionsFile;
+
+  std::string checkpointFile;
+  unsigned checkpointInterval;
+  std::vector<uint8_t> resumePath;
+
   bool debug;
   bool hasOracle;
   LifeStableState oracle;
@@ -251,6 +293,81 @@ SearchParams SearchParams::FromToml(toml::value &toml) {
   params.minMetaFirstActiveGen = metaFirstRange[0];
   params.maxMetaFirstActiveGen = metaFirstRange[1];
 
+  int threads = toml::find_or(toml, "threads", 1);
+  if (threads < 1) {
+    std::cout << "threads must be at least 1" << std::endl; exit(1);
+  }
+  params.threads = threads;
+
+  std::string engineStr = toml::find_or<std::string>(toml, "engine", "ITERATIVE");
+  if (engineStr == "RECURSIVE") {
+    params.engine = SearchEngine::RECURSIVE;
+  } else {
+    params.engine = SearchEngine::ITERATIVE;
+  }
+
+  params.transpositionTableMB = toml::find_or(toml, "transposition-table-mb", 0);
+  std::string replacementStr = toml::find_or<std::string>(toml, "transposition-replacement", "DEPTH");
+  if (replacementStr == "ALWAYS") {
+    params.transpositionReplacement = ReplacementPolicy::ALWAYS;
+  } else {
+    params.transpositionReplacement = ReplacementPolicy::DEPTH;
+  }
+
+  params.nogoods = toml::find_or(toml, "nogoods", false);
+
+  std::string heuristicStr = toml::find_or<std::string>(toml, "branch-heuristic", "DEFAULT");
+  if (heuristicStr == "FEWEST_TRANSITIONS") {
+    params.branchHeuristic = BranchHeuristic::FEWEST_TRANSITIONS;
+  } else if (heuristicStr == "MOST_CONSTRAINED") {
+    params.branchHeuristic = BranchHeuristic::MOST_CONSTRAINED;
+  } else if (heuristicStr == "SEMI_FRONTIER") {
+    params.branchHeuristic = BranchHeuristic::SEMI_FRONTIER;
+  } else {
+    params.branchHeuristic = BranchHeuristic::DEFAULT;
+  }
+  params.branchProbeCells = toml::find_or(toml, "branch-probe-cells", 0);
+  params.regionOrder = toml::find_or(toml, "region-order", false);
+
+  int lookaheadGens = toml::find_or(toml, "lookahead-gens", 6);
+  if (lookaheadGens < 1) {
+    std::cout << "lookahead-gens must be at least 1" << std::endl; exit(1);
+  }
+  params.lookaheadGens = lookaheadGens;
+  params.branchFastCount = toml::find_or(toml, "branch-fast-count", 1);
+  int calculateRounds = toml::find_or(toml, "calculate-rounds", 1);
+  if (calculateRounds < 1) {
+    std::cout << "calculate-rounds must be at least 1" << std::endl; exit(1);
+  }
+  params.calculateRounds = calculateRounds;
+  params.testUnknowns = toml::find_or(toml, "test-unknowns", true);
+  params.testUnknownsThreads = toml::find_or(toml, "test-unknowns-threads", 1);
+  params.probeCacheMB = toml::find_or(toml, "probe-cache-mb", 0);
+  std::vector<int> adaptiveLookahead = toml::find_or<std::vector<int>>(toml, "adaptive-lookahead", {-1, -1});
+  bool adaptiveOff = adaptiveLookahead.size() == 2 && adaptiveLookahead[0] == -1 && adaptiveLookahead[1] == -1;
+  if (!adaptiveOff && (adaptiveLookahead.size() != 2 || adaptiveLookahead[0] < 1 ||
+                       adaptiveLookahead[0] > adaptiveLookahead[1])) {
+    std::cout << "adaptive-lookahead expects [min, max] with 1 <= min <= max" << std::endl; exit(1);
+  }
+  params.adaptiveLookahead.first = adaptiveLookahead[0];
+  params.adaptiveLookahead.second = adaptiveLookahead[1];
+  if (params.adaptiveLookahead.first != -1)
+    params.lookaheadGens = std::clamp(params.lookaheadGens, (unsigned)params.adaptiveLookahead.first,
+                                      (unsigned)params.adaptiveLookahead.second);
+
+  // The shard itself is chosen on the command line
+  params.shardIndex = 0;
+  params.shardCount = 1;
+  int shardDepth = toml::find_or(toml, "shard-depth", 12);
+  if (shardDepth < 1) {
+    std::cout << "shard-depth must be at least 1" << std::endl; exit(1);
+  }
+  params.shardDepth = shardDepth;
+  params.solutionsFile = toml::find_or(toml, "solutions-file", "");
+
+  params.checkpointFile = toml::find_or(toml, "checkpoint-file", "");
+  params.checkpointInterval = toml::find_or(toml, "checkpoint-interval", 300);
+
   params.debug = toml::find_or(toml, "debug", false);
   
   if (toml.contains("oracle")) {
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "LifeAPI.h"
+#include "LifeStableState.hpp"
+
+// Fixed-size table of the outcomes of LifeStableState::TestUnknown.
+// The outcome is determined by the columns the probe touches (see
+// TestUnknown), moved so that the cell is in row 0. Entries hold the
+// strip before and after the probe, so a hit writes the strip back
+// instead of propagating twice. Each key picks one entry, which is
+// replaced on a miss.
+class ProbeCache {
+public:
+  static constexpr unsigned width = 6;
+  static constexpr unsigned planes = 10; // As in LifeStableTrail
+  static constexpr unsigned lockCount = 64;
+
+  using Strip = std::array<std::array<uint64_t, planes>, width>;
+
+  struct Entry {
+    uint64_t key; // 0 marks an empty entry
+    PropagateResult result;
+    Strip before;
+    Strip after;
+  };
+
+  std::unique_ptr<Entry[]> entries;
+  uint64_t entryMask;
+  std::array<std::mutex, lockCount> locks;
+
+  std::atomic<uint64_t> lookups;
+  std::atomic<uint64_t> hits;
+
+  ProbeCache(unsigned megabytes);
+
+  PropagateResult TestUnknown(LifeStableState &stable, std::pair<int, int> cell);
+  PropagateResult TestUnknowns(LifeStableState &stable, const LifeState &cells);
+
+  uint64_t Capacity() const { return entryMask + 1; }
+
+private:
+  static Strip Gather(const LifeStableState &stable, std::pair<int, int> cell);
+  static void Scatter(LifeStableState &stable, std::pair<int, int> cell, const Strip &strip);
+  static uint64_t Key(const Strip &strip);
+};
+
+ProbeCache::ProbeCache(unsigned megabytes) : lookups{0}, hits{0} {
+  uint64_t entryCount = 1;
+  while (2 * entryCount * sizeof(Entry) <= (uint64_t)megabytes << 20)
+    entryCount *= 2;
+  entryMask = entryCount - 1;
+
+  entries = std::make_unique<Entry[]>(entryCount);
+  for (uint64_t i = 0; i < entryCount; i++)
+    entries[i].key = 0;
+}
+
+ProbeCache::Strip ProbeCache::Gather(const LifeStableState &stable, std::pair<int, int> cell) {
+  Strip result;
+  unsigned shift = (N - cell.second) % N;
+  for (unsigned i = 0; i < width; i++) {
+    unsigned c = (cell.first + i + N - 2) % N;
+    result[i] = {stable.state[c], stable.unknown[c], stable.live2[c],
+                 stable.live3[c], stable.dead0[c], stable.dead1[c],
+                 stable.dead2[c], stable.dead4[c], stable.dead5[c],
+                 stable.dead6[c]};
+    for (auto &w : result[i])
+      w = std::rotl(w, shift);
+  }
+  return result;
+}
+
+void ProbeCache::Scatter(LifeStableState &stable, std::pair<int, int> cell, const Strip &strip) {
+  unsigned shift = cell.second;
+  for (unsigned i = 0; i < width; i++) {
+    unsigned c = (cell.first + i + N - 2) % N;
+    const std::array<uint64_t, planes> &col = strip[i];
+    stable.state[c] = std::rotl(col[0], shift);
+    stable.unknown[c] = std::rotl(col[1], shift);
+    stable.live2[c] = std::rotl(col[2], shift);
+    stable.live3[c] = std::rotl(col[3], shift);
+    stable.dead0[c] = std::rotl(col[4], shift);
+    stable.dead1[c] = std::rotl(col[5], shift);
+    stable.dead2[c] = std::rotl(col[6], shift);
+    stable.dead4[c] = std::rotl(col[7], shift);
+    stable.dead5[c] = std::rotl(col[8], shift);
+    stable.dead6[c] = std::rotl(col[9], shift);
+  }
+}
+
+uint64_t ProbeCache::Key(const Strip &strip) {
+  uint64_t result = 0;
+  for (auto &col : strip) {
+    for (uint64_t w : col) {
+      result = (result ^ w) * 0x9E3779B97F4A7C15ULL;
+      result ^= result >> 29;
+    }
+  }
+  return result == 0 ? 1 : result;
+}
+
+PropagateResult ProbeCache::TestUnknown(LifeStableState &stable, std::pair<int, int> cell) {
+  Strip before = Gather(stable, cell);
+  uint64_t key = Key(before);
+  Entry &entry = entries[key & entryMask];
+  std::mutex &lock = locks[key % lockCount];
+
+  lookups.fetch_add(1, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (entry.key == key && entry.before == before) {
+      hits.fetch_add(1, std::memory_order_relaxed);
+      PropagateResult result = entry.result;
+#ifdef DEBUG
+      LifeStableState probed = stable;
+      PropagateResult probedResult = probed.TestUnknown(cell);
+      assert(probedResult.consistent == result.consistent);
+      if (result.consistent) {
+        assert(probedResult.changed == result.changed);
+        assert(Gather(probed, cell) == entry.after);
+      }
+#endif
+      if (result.consistent)
+        Scatter(stable, cell, entry.after);
+      return result;
+    }
+  }
+
+  PropagateResult result = stable.TestUnknown(cell);
+
+  std::lock_guard<std::mutex> guard(lock);
+  entry.key = key;
+  entry.result = result;
+  entry.before = before;
+  if (result.consistent)
+    entry.after = Gather(stable, cell);
+  return result;
+}
+
+PropagateResult ProbeCache::TestUnknowns(LifeStableState &stable, const LifeState &cells) {
+  LifeState remainingCells = cells & stable.unknown;
+  bool anyChanges = false;
+  while (!remainingCells.IsEmpty()) {
+    auto cell = remainingCells.FirstOn();
+    remainingCells.Erase(cell);
+
+    auto result = TestUnknown(stable, cell);
+    if (!result.consistent)
+      return {false, false};
+    anyChanges = anyChanges || result.changed;
+
+    remainingCells &= stable.unknown;
+  }
+
+  return {true, anyChanges};
+}
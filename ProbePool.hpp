@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LifeAPI.h"
+#include "LifeStableState.hpp"
+#include "ProbeCache.hpp"
+
+// Threads for LifeStableState::TestUnknowns. Cells whose probes touch
+// disjoint columns (see TestUnknown) are probed at the same time, in
+// place on the shared state. Batches are chosen from the state alone,
+// so the result does not depend on how the threads are scheduled. The
+// calling thread probes too, and the others join in as they wake up.
+// Probes go through the cache, if there is one.
+class ProbePool {
+public:
+  ProbePool(unsigned threads, ProbeCache *cache);
+  ~ProbePool();
+
+  PropagateResult TestUnknowns(LifeStableState &stable, const LifeState &cells);
+
+private:
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable wake;
+  uint64_t round;
+  bool open; // Whether threads may still join the current round
+  bool stopping;
+  ProbeCache *cache;
+
+  // The batch being probed
+  LifeStableState *stable;
+  std::vector<std::pair<int, int>> batch;
+  std::vector<PropagateResult> results;
+  std::atomic<unsigned> next;
+  std::atomic<unsigned> finished;
+  std::atomic<unsigned> active;
+
+  PropagateResult Probe(LifeStableState &state, std::pair<int, int> cell);
+  void ProbeBatch();
+  void RunBatch();
+  void Loop();
+};
+
+ProbePool::ProbePool(unsigned count, ProbeCache *incache)
+    : round{0}, open{false}, stopping{false}, cache{incache}, stable{nullptr},
+      next{0}, finished{0}, active{0} {
+  for (unsigned i = 1; i < count; i++)
+    threads.emplace_back(&ProbePool::Loop, this);
+}
+
+ProbePool::~ProbePool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &t : threads)
+    t.join();
+}
+
+PropagateResult ProbePool::Probe(LifeStableState &state, std::pair<int, int> cell) {
+  if (cache != nullptr)
+    return cache->TestUnknown(state, cell);
+  return state.TestUnknown(cell);
+}
+
+void ProbePool::ProbeBatch() {
+  unsigned i;
+  while ((i = next.fetch_add(1, std::memory_order_relaxed)) < batch.size()) {
+    results[i] = Probe(*stable, batch[i]);
+    finished.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void ProbePool::Loop() {
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return stopping || (open && round != seen); });
+      if (stopping)
+        return;
+      seen = round;
+      active.fetch_add(1, std::memory_order_relaxed);
+    }
+    ProbeBatch();
+    active.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void ProbePool::RunBatch() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    next = 0;
+    finished = 0;
+    round++;
+    open = true;
+  }
+  wake.notify_all();
+
+  ProbeBatch();
+  while (finished.load(std::memory_order_acquire) < batch.size())
+    std::this_thread::yield();
+
+  // No thread may start on this batch once it is replaced
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    open = false;
+  }
+  while (active.load(std::memory_order_acquire) != 0)
+    std::this_thread::yield();
+}
+
+PropagateResult ProbePool::TestUnknowns(LifeStableState &state, const LifeState &cells) {
+  stable = &state;
+
+  LifeState remainingCells = cells & state.unknown;
+  bool anyChanges = false;
+  while (!remainingCells.IsEmpty()) {
+    // The first cell of each column, skipping columns too close to
+    // one already taken
+    batch.clear();
+    uint64_t usedColumns = 0;
+    for (unsigned x = 0; x < N; x++) {
+      if (remainingCells[x] == 0)
+        continue;
+      uint64_t columns = std::rotl(0x3FULL, (x + N - 2) % N);
+      if ((usedColumns & columns) != 0)
+        continue;
+      usedColumns |= columns;
+      batch.push_back({x, std::countr_zero(remainingCells[x])});
+    }
+
+    results.resize(batch.size());
+    if (batch.size() == 1 || threads.empty())
+      for (unsigned i = 0; i < batch.size(); i++)
+        results[i] = Probe(state, batch[i]);
+    else
+      RunBatch();
+
+    for (unsigned i = 0; i < batch.size(); i++) {
+      if (!results[i].consistent)
+        return {false, false};
+      anyChanges = anyChanges || results[i].changed;
+      remainingCells.Erase(batch[i]);
+    }
+
+    remainingCells &= state.unknown;
+  }
+
+  return {true, anyChanges};
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+enum class ReplacementPolicy {
+  DEPTH, // Evict the deepest entry, which covers the smallest subtree
+  ALWAYS // Evict whichever entry the key picks
+};
+
+// Fixed-size table of the hashes of nodes that have already been
+// searched. Entries are updated without locking: a torn entry can only
+// cost a miss, and a hit needs the full 64-bit key to match.
+class TranspositionTable {
+public:
+  static constexpr unsigned bucketSize = 4;
+
+  struct Entry {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> depth;
+  };
+
+  struct alignas(64) Bucket {
+    std::array<Entry, bucketSize> entries;
+  };
+
+  std::unique_ptr<Bucket[]> buckets;
+  uint64_t bucketMask;
+  ReplacementPolicy policy;
+
+  std::atomic<uint64_t> lookups;
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> evictions;
+
+  TranspositionTable(unsigned megabytes, ReplacementPolicy policy);
+
+  // Whether `key` has been seen before. If not, it is stored.
+  bool Visit(uint64_t key, unsigned depth);
+
+  uint64_t Capacity() const { return (bucketMask + 1) * bucketSize; }
+};
+
+TranspositionTable::TranspositionTable(unsigned megabytes, ReplacementPolicy inpolicy)
+    : policy{inpolicy}, lookups{0}, hits{0}, evictions{0} {
+  uint64_t bucketCount = 1;
+  while (2 * bucketCount * sizeof(Bucket) <= (uint64_t)megabytes << 20)
+    bucketCount *= 2;
+  bucketMask = bucketCount - 1;
+
+  buckets = std::make_unique<Bucket[]>(bucketCount);
+  for (uint64_t i = 0; i < bucketCount; i++) {
+    for (auto &e : buckets[i].entries) {
+      e.key = 0;
+      e.depth = 0;
+    }
+  }
+}
+
+bool TranspositionTable::Visit(uint64_t key, unsigned depth) {
+  if (key == 0)
+    key = 1; // 0 marks an empty entry
+
+  lookups.fetch_add(1, std::memory_order_relaxed);
+
+  Bucket &bucket = buckets[key & bucketMask];
+  for (auto &e : bucket.entries) {
+    if (e.key.load(std::memory_order_relaxed) == key) {
+      hits.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  Entry *victim = nullptr;
+  for (auto &e : bucket.entries) {
+    if (e.key.load(std::memory_order_relaxed) == 0) {
+      victim = &e;
+      break;
+    }
+  }
+
+  if (victim == nullptr) {
+    switch (policy) {
+    case ReplacementPolicy::DEPTH:
+      victim = &bucket.entries[0];
+      for (auto &e : bucket.entries) {
+        if (e.depth.load(std::memory_order_relaxed) > victim->depth.load(std::memory_order_relaxed))
+          victim = &e;
+      }
+      break;
+    case ReplacementPolicy::ALWAYS:
+      victim = &bucket.entries[(key >> 32) % bucketSize];
+      break;
+    }
+    evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  victim->key.store(key, std::memory_order_relaxed);
+  victim->depth.store(depth, std::memory_order_relaxed);
+  return false;
+}
@@ -0,0 +1,224 @@
+// Runs Barrister over a set of inputs with every combination of the
+// given search settings, and reports which combinations are worth
+// using. Each run is a separate `./Barrister input --set key=value ...`
+// process, so the settings and the inputs are left untouched.
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Sweep {
+  std::string key;
+  std::vector<std::string> values;
+};
+
+struct RunResult {
+  bool ok;
+  unsigned long nodes;
+  unsigned solutions; // Distinct completed catalysts
+  double seconds;
+};
+
+struct ConfigResult {
+  std::vector<std::string> values; // One for each sweep
+  RunResult total;
+};
+
+const std::vector<Sweep> defaultSweeps = {
+    {"lookahead-gens", {"4", "6", "8"}},
+    {"branch-fast-count", {"1", "2"}},
+    {"branch-heuristic", {"\"DEFAULT\"", "\"MOST_CONSTRAINED\""}},
+    {"transposition-table-mb", {"0", "64"}},
+};
+
+Sweep ParseSweep(const std::string &spec) {
+  Sweep result;
+  auto eq = spec.find('=');
+  if (eq == std::string::npos) {
+    std::cout << "--sweep expects key=value,value,..." << std::endl; exit(1);
+  }
+  result.key = spec.substr(0, eq);
+  std::stringstream values(spec.substr(eq + 1));
+  std::string value;
+  while (std::getline(values, value, ','))
+    result.values.push_back(value);
+  return result;
+}
+
+std::string ShellQuote(const std::string &s) {
+  std::string result = "'";
+  for (char c : s) {
+    if (c == '\'')
+      result += "'\\''";
+    else
+      result += c;
+  }
+  return result + "'";
+}
+
+RunResult RunBarrister(const std::string &barrister, const std::string &input,
+                       const std::vector<Sweep> &sweeps,
+                       const std::vector<std::string> &values) {
+  std::string command = ShellQuote(barrister) + " " + ShellQuote(input) + " --set print-summary=true";
+  for (unsigned i = 0; i < sweeps.size(); i++)
+    command += " --set " + ShellQuote(sweeps[i].key + "=" + values[i]);
+  command += " 2>&1";
+
+  RunResult result = {false, 0, 0, 0};
+
+  auto start = std::chrono::steady_clock::now();
+  FILE *pipe = popen(command.c_str(), "r");
+  if (pipe == nullptr)
+    return result;
+
+  // A winner only counts if it could be completed, and the same
+  // completion found twice counts once
+  std::set<std::string> completed;
+  bool completionNext = false;
+
+  char buffer[4096];
+  while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+    std::string line = buffer;
+    if (completionNext)
+      completed.insert(line);
+    completionNext = line.rfind("Completed:", 0) == 0;
+    if (line.rfind("Search stats:", 0) == 0) {
+      auto comma = line.find(", ");
+      if (comma != std::string::npos &&
+          std::sscanf(line.c_str() + comma + 2, "%lu nodes", &result.nodes) == 1)
+        result.ok = true;
+    }
+  }
+  int status = pclose(pipe);
+  result.solutions = completed.size();
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (status != 0)
+    result.ok = false;
+  return result;
+}
+
+// Whether `a` is at least as good as `b` in every measure and better
+// in one: more solutions, fewer nodes, less time
+bool Dominates(const RunResult &a, const RunResult &b) {
+  bool noWorse = a.solutions >= b.solutions && a.nodes <= b.nodes && a.seconds <= b.seconds;
+  bool better = a.solutions > b.solutions || a.nodes < b.nodes || a.seconds < b.seconds;
+  return noWorse && better;
+}
+
+void PrintRow(const std::vector<Sweep> &sweeps, const ConfigResult &config) {
+  for (unsigned i = 0; i < sweeps.size(); i++)
+    std::cout << std::setw(std::max<int>(sweeps[i].key.size(), 8)) << config.values[i] << "  ";
+  std::cout << std::setw(12) << config.total.nodes << "  "
+            << std::setw(9) << std::fixed << std::setprecision(2) << config.total.seconds << "  "
+            << std::setw(9) << config.total.solutions << std::endl;
+}
+
+void PrintHeader(const std::vector<Sweep> &sweeps) {
+  for (auto &s : sweeps)
+    std::cout << std::setw(std::max<int>(s.key.size(), 8)) << s.key << "  ";
+  std::cout << std::setw(12) << "nodes" << "  " << std::setw(9) << "seconds" << "  "
+            << std::setw(9) << "solutions" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  std::string barrister = "./Barrister";
+  std::vector<Sweep> sweeps;
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--barrister" && i + 1 < argc) {
+      barrister = argv[++i];
+    } else if (arg == "--sweep" && i + 1 < argc) {
+      sweeps.push_back(ParseSweep(argv[++i]));
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+
+  if (inputs.empty()) {
+    std::cout << "Usage: Barrister-tune [--barrister path] [--sweep key=value,...]... input.toml..." << std::endl;
+    exit(1);
+  }
+  if (sweeps.empty())
+    sweeps = defaultSweeps;
+
+  std::vector<ConfigResult> results;
+
+  PrintHeader(sweeps);
+
+  // Count through every combination of values, the last sweep fastest
+  std::vector<unsigned> indices(sweeps.size(), 0);
+  while (true) {
+    ConfigResult config;
+    config.total = {true, 0, 0, 0};
+    for (unsigned i = 0; i < sweeps.size(); i++)
+      config.values.push_back(sweeps[i].values[indices[i]]);
+
+    for (auto &input : inputs) {
+      RunResult run = RunBarrister(barrister, input, sweeps, config.values);
+      if (!run.ok) {
+        std::cerr << "Failed: " << input;
+        for (unsigned i = 0; i < sweeps.size(); i++)
+          std::cerr << " " << sweeps[i].key << "=" << config.values[i];
+        std::cerr << std::endl;
+        config.total.ok = false;
+        break;
+      }
+      config.total.nodes += run.nodes;
+      config.total.solutions += run.solutions;
+      config.total.seconds += run.seconds;
+    }
+
+    if (config.total.ok) {
+      PrintRow(sweeps, config);
+      results.push_back(config);
+    }
+
+    int i = sweeps.size() - 1;
+    while (i >= 0 && ++indices[i] == sweeps[i].values.size()) {
+      indices[i] = 0;
+      i--;
+    }
+    if (i < 0)
+      break;
+  }
+
+  std::vector<ConfigResult> front;
+  for (auto &a : results) {
+    bool dominated = false;
+    for (auto &b : results) {
+      if (Dominates(b.total, a.total)) {
+        dominated = true;
+        break;
+      }
+    }
+    if (!dominated)
+      front.push_back(a);
+  }
+
+  if (front.empty())
+    return 1;
+
+  std::cout << std::endl << "Pareto front:" << std::endl;
+  PrintHeader(sweeps);
+  for (auto &c : front)
+    PrintRow(sweeps, c);
+
+  // The fastest of those that find the most solutions
+  const ConfigResult *best = &front[0];
+  for (auto &c : front) {
+    if (c.total.solutions > best->total.solutions ||
+        (c.total.solutions == best->total.solutions && c.total.seconds < best->total.seconds))
+      best = &c;
+  }
+
+  std::cout << std::endl << "# Best settings for these inputs" << std::endl;
+  for (unsigned i = 0; i < sweeps.size(); i++)
+    std::cout << sweeps[i].key << " = " << best->values[i] << std::endl;
+}